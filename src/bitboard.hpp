@@ -0,0 +1,388 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "boardtile.hpp"
+#include "mineboard.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Alternative storage backend for board tiles. Mine, open and flag
+ * states are kept in separate bit planes packed into 64-bit words and tile
+ * values are kept in a nibble plane holding 16 tiles per word. Counting and
+ * masking is done a word at a time instead of a tile at a time, and so are
+ * the neighbourhoods of whole planes. Tiles take seven bits against the
+ * byte of a %BoardTile, as everything else is derived when needed.
+ * @note Bits past %tile_count() in the last word of each plane are always
+ * kept cleared so whole planes can be counted without masking.
+ */
+class BitBoard {
+public:
+  using this_type = BitBoard;
+  using word_type = std::uint64_t;
+  using plane_type = std::vector<word_type>;
+  using value_type = BoardTile::value_type;
+
+  static constexpr size_type WORD_BITS = 64;
+  static constexpr size_type NIBBLE_BITS = 4;
+  static constexpr size_type NIBBLES_PER_WORD = WORD_BITS / NIBBLE_BITS;
+
+private:
+  // Bit plane of mined tiles.
+  plane_type m_mines;
+  // Bit plane of opened tiles.
+  plane_type m_open;
+  // Bit plane of flagged tiles.
+  plane_type m_flagged;
+  // Nibble plane of tile values. Mines are stored as %BoardTile::TILE_MINE.
+  plane_type m_values;
+  // Variable for storing the board width.
+  size_type m_width;
+  // Variable for storing the board height.
+  size_type m_height;
+
+public:
+  // @brief Default constructor without parameters.
+  BitBoard() : m_width(0), m_height(0) {}
+  // @brief Constructs cleared planes for given dimensions.
+  BitBoard(size_type width, size_type height) : m_width(0), m_height(0) {
+    resize(width, height);
+  }
+  // @brief Constructs planes from the tiles of %board.
+  explicit BitBoard(const MineBoard& board) : m_width(0), m_height(0) {
+    load(board);
+  }
+  ~BitBoard() noexcept {}
+
+  // @brief Sets plane dimensions and clears every plane.
+  void resize(size_type width, size_type height) {
+    m_width = width;
+    m_height = height;
+    const auto words = m_word_count(tile_count(), WORD_BITS);
+    m_mines.assign(words, 0);
+    m_open.assign(words, 0);
+    m_flagged.assign(words, 0);
+    m_values.assign(m_word_count(tile_count(), NIBBLES_PER_WORD), 0);
+  }
+
+  // @brief Sets every tile to a closed, unflagged and empty one.
+  void clear() noexcept {
+    std::fill(m_mines.begin(), m_mines.end(), 0);
+    std::fill(m_open.begin(), m_open.end(), 0);
+    std::fill(m_flagged.begin(), m_flagged.end(), 0);
+    std::fill(m_values.begin(), m_values.end(), 0);
+  }
+
+  // @brief Returns the width of the board.
+  constexpr size_type width() const noexcept { return m_width; }
+
+  // @brief Returns the height of the board.
+  constexpr size_type height() const noexcept { return m_height; }
+
+  // @brief Returns the amount of tiles on the board.
+  constexpr size_type tile_count() const noexcept { return m_width * m_height; }
+
+  // @brief Returns the mine plane.
+  const plane_type& mines() const noexcept { return m_mines; }
+
+  // @brief Returns the open plane.
+  const plane_type& open() const noexcept { return m_open; }
+
+  // @brief Returns the flag plane.
+  const plane_type& flagged() const noexcept { return m_flagged; }
+
+  // @brief Stores the plane of numbered tiles, open or not, to %numbers.
+  // Derived from the values sixteen tiles at a time.
+  void numbers(plane_type& numbers) const {
+    numbers.assign(m_mines.size(), 0);
+    for (size_type n = 0; n < m_values.size(); ++n)
+      numbers[n * NIBBLES_PER_WORD / WORD_BITS] |=
+          m_number_bits(m_values[n])
+          << (n * NIBBLES_PER_WORD % WORD_BITS);
+  }
+
+  // @brief Returns true when tile is a mine. False otherwise.
+  bool is_mine(size_type idx) const noexcept { return m_test(m_mines, idx); }
+
+  // @brief Returns true when tile is open. False otherwise.
+  bool is_open(size_type idx) const noexcept { return m_test(m_open, idx); }
+
+  // @brief Returns true when tile is flagged. False otherwise.
+  bool is_flagged(size_type idx) const noexcept {
+    return m_test(m_flagged, idx);
+  }
+
+  // @brief Returns the value of the tile. Mines return
+  // %BoardTile::TILE_MINE.
+  value_type value(size_type idx) const noexcept {
+    return static_cast<value_type>(
+        (m_values[idx / NIBBLES_PER_WORD] >> m_nibble_shift(idx)) & 0xF);
+  }
+
+  // @brief Sets the value of the tile. Setting %BoardTile::TILE_MINE also
+  // sets the tile's bit on the mine plane and any other value clears it.
+  void value(size_type idx, value_type new_value) noexcept {
+    auto& word = m_values[idx / NIBBLES_PER_WORD];
+    const auto shift = m_nibble_shift(idx);
+    word = (word & ~(word_type{0xF} << shift)) |
+           (word_type{new_value & 0xFu} << shift);
+    m_assign(m_mines, idx, new_value == BoardTile::TILE_MINE);
+  }
+
+  // @brief Sets tile to a mine.
+  void set_mine(size_type idx) noexcept { value(idx, BoardTile::TILE_MINE); }
+
+  // @brief Sets tile open or closed.
+  void set_open(size_type idx, bool open = true) noexcept {
+    m_assign(m_open, idx, open);
+  }
+
+  // @brief Sets tile flagged or unflagged.
+  void set_flagged(size_type idx, bool flagged = true) noexcept {
+    m_assign(m_flagged, idx, flagged);
+  }
+
+  // @brief Returns the amount of mines on the board.
+  size_type mine_count() const noexcept { return m_count(m_mines); }
+
+  // @brief Returns the amount of opened tiles on the board.
+  size_type open_tiles_count() const noexcept { return m_count(m_open); }
+
+  // @brief Returns the amount of flagged tiles on the board.
+  size_type flagged_tiles_count() const noexcept { return m_count(m_flagged); }
+
+  // @brief Returns the amount of tiles which are neither open nor flagged.
+  size_type unknown_tiles_count() const noexcept {
+    size_type count = 0;
+    for (size_type w = 0; w < m_open.size(); ++w)
+      count += bit_count(~(m_open[w] | m_flagged[w]) & m_valid_bits(w));
+    return count;
+  }
+
+  // @brief Stores the plane of tiles which are neither open nor flagged to
+  // %unknown.
+  void unknown(plane_type& unknown) const {
+    unknown.resize(m_open.size());
+    for (size_type w = 0; w < m_open.size(); ++w)
+      unknown[w] = ~(m_open[w] | m_flagged[w]) & m_valid_bits(w);
+  }
+
+  // @brief Stores the plane of tiles which have a neighbour on %plane to
+  // %adjacent, which must not be %plane. Plane is spread a row up and down a
+  // word at a time and the result a column left and right. Neighbours to the
+  // left of first column tiles would be on the previous row and those to the
+  // right of last column tiles on the next, so these columns are masked out
+  // of the spread from that side.
+  void adjacent(const plane_type& plane, plane_type& adjacent) const {
+    const auto size = plane.size();
+    const auto width = static_cast<diff_type>(m_width);
+    diff_type up_words, up_bits, down_words, down_bits;
+    m_split_shift(-width, up_words, up_bits);
+    m_split_shift(width, down_words, down_bits);
+    // Tiles with a neighbour on %plane directly above or below them.
+    const auto vertical = [&](size_type w) {
+      return m_shifted(plane, w, up_words, up_bits) |
+             m_shifted(plane, w, down_words, down_bits);
+    };
+    adjacent.resize(size);
+    // Tiles on %plane or directly above or below one, for the previous, the
+    // current and the next word.
+    word_type previous = 0, current = 0, next = 0;
+    word_type current_vertical = 0, next_vertical = 0;
+    if (size != 0) {
+      current_vertical = vertical(0);
+      current = plane[0] | current_vertical;
+    }
+    // Column of the first tile of the current word.
+    size_type column = 0;
+    for (size_type w = 0; w < size; ++w) {
+      next = next_vertical = 0;
+      if (w + 1 < size) {
+        next_vertical = vertical(w + 1);
+        next = plane[w + 1] | next_vertical;
+      }
+      const auto left = current << 1 | previous >> (WORD_BITS - 1),
+                 right = current >> 1 | next << (WORD_BITS - 1);
+      adjacent[w] = current_vertical |
+                    (left & ~m_column_bits(column, 0)) |
+                    (right & ~m_column_bits(column, m_width - 1));
+      previous = current;
+      current = next;
+      current_vertical = next_vertical;
+      column = (column + WORD_BITS) % m_width;
+    }
+    if (size != 0)
+      adjacent.back() &= m_valid_bits(size - 1);
+  }
+
+  // @brief Returns the amount of flags which are not placed on mines.
+  size_type misplaced_flags_count() const noexcept {
+    size_type count = 0;
+    for (size_type w = 0; w < m_flagged.size(); ++w)
+      count += bit_count(m_flagged[w] & ~m_mines[w]);
+    return count;
+  }
+
+  // @brief Returns true when every tile without a mine is open.
+  bool b_cleared() const noexcept {
+    for (size_type w = 0; w < m_open.size(); ++w)
+      if ((~(m_open[w] | m_mines[w]) & m_valid_bits(w)) != 0)
+        return false;
+    return true;
+  }
+
+  // @brief Returns next tile index with the type of mine starting from
+  // %offset. If mine not found until the end of the plane, returns the
+  // maximum value of size_type.
+  size_type next_mine(size_type offset) const noexcept {
+    return m_next_set(m_mines, offset);
+  }
+
+  // @brief Copies tile states of %board into the planes.
+  void load(const MineBoard& board) {
+    resize(board.width(), board.height());
+    for (size_type i = 0; i < tile_count(); ++i)
+      update(board, i);
+  }
+
+  // @brief Copies state of tile %idx of %board, which has the dimensions of
+  // the planes.
+  void update(const MineBoard& board, size_type idx) noexcept {
+    const auto& tile = board.m_tiles[idx];
+    value(idx, tile.value());
+    m_assign(m_open, idx, tile.is_open());
+    m_assign(m_flagged, idx, tile.is_flagged());
+  }
+
+  // @brief Copies tile states from the planes to %board. Board is resized to
+  // plane dimensions, its mine count is set to the amount of mines on the mine
+  // plane, its running counters are recalculated and its observers notified.
+  void store(MineBoard& board) const {
+    board.resize(m_width, m_height);
+    for (size_type i = 0; i < tile_count(); ++i) {
+      const BoardTile tile(value(i), is_flagged(i), is_open(i));
+      board.m_tiles[i] = tile;
+    }
+    board.m_mine_count = mine_count();
+    board.m_recount();
+    board.m_note_all_changed();
+    board.m_notify_observers();
+  }
+
+private:
+  // @brief Returns the amount of words needed to hold %count items packed
+  // %per_word to a word.
+  static constexpr size_type m_word_count(size_type count,
+                                          size_type per_word) noexcept {
+    return (count + per_word - 1) / per_word;
+  }
+
+  // @brief Returns the shift of tile's nibble inside its word.
+  static constexpr size_type m_nibble_shift(size_type idx) noexcept {
+    return (idx % NIBBLES_PER_WORD) * NIBBLE_BITS;
+  }
+
+  // @brief Returns mask of bits in word %w which map to tiles on the board.
+  word_type m_valid_bits(size_type w) const noexcept {
+    const auto tail = tile_count() % WORD_BITS;
+    if (tail == 0 || w + 1 < m_word_count(tile_count(), WORD_BITS))
+      return std::numeric_limits<word_type>::max();
+    return (word_type{1} << tail) - 1;
+  }
+
+  static bool m_test(const plane_type& plane, size_type idx) noexcept {
+    return (plane[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1;
+  }
+
+  static void m_assign(plane_type& plane, size_type idx, bool bit) noexcept {
+    const auto mask = word_type{1} << (idx % WORD_BITS);
+    if (bit)
+      plane[idx / WORD_BITS] |= mask;
+    else
+      plane[idx / WORD_BITS] &= ~mask;
+  }
+
+  // @brief Splits %shift to %words and %bits, rounding down also when
+  // negative.
+  static void m_split_shift(diff_type shift, diff_type& words,
+                            diff_type& bits) noexcept {
+    const auto word_bits = static_cast<diff_type>(WORD_BITS);
+    words = shift / word_bits;
+    bits = shift % word_bits;
+    if (bits < 0) {
+      bits += word_bits;
+      --words;
+    }
+  }
+
+  // @brief Returns word %w of %plane shifted by %words and %bits, where each
+  // bit is that of the tile %words * %WORD_BITS + %bits tiles further.
+  static word_type m_shifted(const plane_type& plane, size_type w,
+                             diff_type words, diff_type bits) noexcept {
+    const auto size = static_cast<diff_type>(plane.size());
+    const auto low = static_cast<diff_type>(w) + words, high = low + 1;
+    word_type word = 0;
+    if (low >= 0 && low < size)
+      word |= plane[low] >> bits;
+    if (bits != 0 && high >= 0 && high < size)
+      word |= plane[high] << (WORD_BITS - bits);
+    return word;
+  }
+
+  // @brief Returns the bits of a word, whose first tile is on %column, which
+  // map to tiles on column %target.
+  word_type m_column_bits(size_type column, size_type target) const noexcept {
+    word_type bits = 0;
+    for (auto p = (target + m_width - column) % m_width; p < WORD_BITS;
+         p += m_width)
+      bits |= word_type{1} << p;
+    return bits;
+  }
+
+  // @brief Returns a bit for each nibble of %values, packed to the low
+  // sixteen bits, set if the nibble holds a number.
+  static constexpr word_type m_number_bits(word_type values) noexcept {
+    constexpr word_type LOW = 0x1111111111111111;
+    const auto other = values ^ (LOW * BoardTile::TILE_MINE);
+    auto bits = (values | values >> 1 | values >> 2 | values >> 3) &
+                (other | other >> 1 | other >> 2 | other >> 3) & LOW;
+    bits = (bits | bits >> 3) & 0x0303030303030303;
+    bits = (bits | bits >> 6) & 0x000F000F000F000F;
+    bits = (bits | bits >> 12) & 0x000000FF000000FF;
+    return (bits | bits >> 24) & 0xFFFF;
+  }
+
+  static size_type m_count(const plane_type& plane) noexcept {
+    size_type count = 0;
+    for (auto word : plane)
+      count += bit_count(word);
+    return count;
+  }
+
+  // @brief Returns next set bit of %plane starting from %offset or the maximum
+  // value of size_type if there is none.
+  size_type m_next_set(const plane_type& plane, size_type offset) const
+      noexcept {
+    if (offset >= tile_count())
+      return std::numeric_limits<size_type>::max();
+    auto w = offset / WORD_BITS;
+    auto word = plane[w] & (std::numeric_limits<word_type>::max()
+                            << (offset % WORD_BITS));
+    while (word == 0) {
+      if (++w == plane.size())
+        return std::numeric_limits<size_type>::max();
+      word = plane[w];
+    }
+    return w * WORD_BITS + bit_scan(word);
+  }
+};
+
+} // namespace rake
+
+#endif
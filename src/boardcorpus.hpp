@@ -0,0 +1,346 @@
+#ifndef BOARDCORPUS_HPP
+#define BOARDCORPUS_HPP
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RAKE_CORPUS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mineboard.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Binary file of mine layouts. File starts with a fixed-size header,
+ * followed by board records and an index of their byte offsets, which the
+ * header points to. Each record has a fixed-size head and the board's mines
+ * packed into 64-bit words, 64 tiles per word.
+ * @note All fields are 64-bit aligned and stored in the byte order of the
+ * machine, which is little-endian on every supported platform.
+ */
+struct BoardCorpus {
+  static constexpr char MAGIC[8] = {'R', 'A', 'K', 'E', 'C', 'O', 'R', 'P'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    // Amount of boards in the corpus.
+    std::uint64_t board_count;
+    // Byte offset of the record offset index.
+    std::uint64_t index_offset;
+  };
+
+  struct Record {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t mine_count;
+    std::uint32_t reserved;
+    // Seed and index of the board in its series.
+    std::uint64_t seed;
+    std::uint64_t board_index;
+  };
+
+  // @brief Returns the amount of words holding the mines of %tile_count
+  // tiles.
+  static constexpr size_type word_count(size_type tile_count) noexcept {
+    return (tile_count + 63) / 64;
+  }
+};
+
+/**
+ * @brief Writes boards to a corpus file one at a time. Index and header are
+ * written when the writer is closed.
+ */
+class CorpusWriter {
+public:
+  using this_type = CorpusWriter;
+
+private:
+  std::ofstream m_file;
+  std::vector<std::uint64_t> m_offsets;
+  std::uint64_t m_offset;
+  // Scratch space for packed mines.
+  std::vector<std::uint64_t> m_words;
+
+public:
+  CorpusWriter() : m_offset(0) {}
+  explicit CorpusWriter(const std::string& path) : m_offset(0) { open(path); }
+  CorpusWriter(const this_type&) = delete;
+  ~CorpusWriter() { close(); }
+
+  // @brief Creates corpus file %path, replacing an existing one. Returns false
+  // if the file couldn't be opened.
+  bool open(const std::string& path) {
+    close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+      std::cerr << "\nError: Couldn't open corpus for writing: " << path;
+      return false;
+    }
+    m_offsets.clear();
+    // Header is written for real on close.
+    const BoardCorpus::Header header{};
+    m_write(&header, sizeof(header));
+    return true;
+  }
+
+  // @brief Returns true if a corpus is open for writing.
+  bool is_open() const { return m_file.is_open(); }
+
+  // @brief Returns the amount of boards written so far.
+  size_type size() const noexcept { return m_offsets.size(); }
+
+  // @brief Appends mine layout of %board. Board's mines should be laid, which
+  // happens on its first move.
+  bool write(const MineBoard& board) {
+    if (!m_file)
+      return false;
+    const BoardCorpus::Record record{
+        static_cast<std::uint32_t>(board.width()),
+        static_cast<std::uint32_t>(board.height()),
+        static_cast<std::uint32_t>(board.mine_count()),
+        0,
+        board.seed(),
+        board.board_index()};
+    m_words.assign(BoardCorpus::word_count(board.tile_count()), 0);
+    for (size_type i = 0; i < board.tile_count(); ++i)
+      if (board.m_tiles[i].is_mine())
+        m_words[i / 64] |= std::uint64_t{1} << (i % 64);
+
+    m_offsets.emplace_back(m_offset);
+    m_write(&record, sizeof(record));
+    m_write(m_words.data(), m_words.size() * sizeof(std::uint64_t));
+    return static_cast<bool>(m_file);
+  }
+
+  // @brief Writes the index and the header and closes the file. Returns false
+  // if any write failed.
+  bool close() {
+    if (!m_file.is_open())
+      return true;
+    BoardCorpus::Header header{};
+    std::memcpy(header.magic, BoardCorpus::MAGIC, sizeof(header.magic));
+    header.version = BoardCorpus::VERSION;
+    header.board_count = m_offsets.size();
+    header.index_offset = m_offset;
+    m_write(m_offsets.data(), m_offsets.size() * sizeof(std::uint64_t));
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const bool b_ok = static_cast<bool>(m_file);
+    m_file.close();
+    if (!b_ok)
+      std::cerr << "\nError: Couldn't write corpus.";
+    return b_ok;
+  }
+
+private:
+  void m_write(const void* data, size_type size) {
+    m_file.write(static_cast<const char*>(data), size);
+    m_offset += size;
+  }
+};
+
+/**
+ * @brief Read-only view of a corpus file. File is mapped to memory where
+ * supported and read whole otherwise. Boards are accessed in constant time
+ * straight from the mapping, so a single reader can be shared by any amount
+ * of threads.
+ */
+class CorpusReader {
+public:
+  using this_type = CorpusReader;
+
+  // @brief View of a single board record inside the corpus.
+  class BoardView {
+  public:
+    BoardView(const BoardCorpus::Record* record, const std::uint64_t* mines)
+        : m_record(record), m_mines(mines) {}
+
+    size_type width() const noexcept { return m_record->width; }
+    size_type height() const noexcept { return m_record->height; }
+    size_type tile_count() const noexcept { return width() * height(); }
+    size_type mine_count() const noexcept { return m_record->mine_count; }
+    MineBoard::seed_type seed() const noexcept { return m_record->seed; }
+    MineBoard::seed_type board_index() const noexcept {
+      return m_record->board_index;
+    }
+
+    // @brief Returns packed mine words, 64 tiles per word.
+    const std::uint64_t* mine_words() const noexcept { return m_mines; }
+
+    // @brief Returns true when tile is a mine. False otherwise.
+    bool is_mine(size_type idx) const noexcept {
+      return (m_mines[idx / 64] >> (idx % 64)) & 1;
+    }
+
+  private:
+    const BoardCorpus::Record* m_record;
+    const std::uint64_t* m_mines;
+  };
+
+private:
+  const unsigned char* m_data;
+  size_type m_size;
+  const std::uint64_t* m_offsets;
+  size_type m_board_count;
+  size_type m_index_offset;
+  // Holds the file when it isn't mapped.
+  std::vector<std::uint64_t> m_buffer;
+
+public:
+  CorpusReader()
+      : m_data(nullptr), m_size(0), m_offsets(nullptr), m_board_count(0),
+        m_index_offset(0) {}
+  explicit CorpusReader(const std::string& path) : CorpusReader() {
+    open(path);
+  }
+  CorpusReader(const this_type&) = delete;
+  ~CorpusReader() noexcept { close(); }
+
+  // @brief Opens corpus file %path and validates its header and index.
+  // Returns false if the file can't be used.
+  bool open(const std::string& path) {
+    close();
+    if (!m_map(path))
+      return false;
+    if (!m_validate()) {
+      std::cerr << "\nError: Invalid corpus: " << path;
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() noexcept {
+#ifdef RAKE_CORPUS_MMAP
+    if (m_data != nullptr && m_buffer.empty())
+      munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_offsets = nullptr;
+    m_board_count = 0;
+    m_index_offset = 0;
+  }
+
+  // @brief Returns true if a corpus is open.
+  bool is_open() const noexcept { return m_data != nullptr; }
+
+  // @brief Returns the amount of boards in the corpus.
+  size_type size() const noexcept { return m_board_count; }
+
+  // @brief Returns the %k:th board of the corpus. %k must be less than
+  // %size(). Record which doesn't fit inside the file is viewed as an empty
+  // board.
+  BoardView view(size_type k) const noexcept {
+    static const BoardCorpus::Record empty{};
+    const auto offset = m_offsets[k];
+    const auto* record =
+        reinterpret_cast<const BoardCorpus::Record*>(m_data + offset);
+    const auto* mines = reinterpret_cast<const std::uint64_t*>(record + 1);
+    const auto space = m_index_offset - offset - sizeof(BoardCorpus::Record);
+    if (BoardCorpus::word_count(size_type{record->width} * record->height) >
+        space / 8)
+      return {&empty, mines};
+    return {record, mines};
+  }
+
+  // @brief Initializes %board to the %k:th board of the corpus with its mines
+  // laid, ready for its next move.
+  void load(size_type k, MineBoard& board) const {
+    const auto record = view(k);
+    board.init(record.width(), record.height(), record.seed(),
+               record.mine_count(), record.board_index());
+    std::vector<bool> mines(record.tile_count());
+    for (size_type i = 0; i < mines.size(); ++i)
+      mines[i] = record.is_mine(i);
+    board.lay_mines(mines);
+  }
+
+private:
+  bool m_map(const std::string& path) {
+#ifdef RAKE_CORPUS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "\nError: Couldn't open corpus: " << path;
+      return false;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      std::cerr << "\nError: Couldn't map corpus: " << path;
+      return false;
+    }
+    m_data = static_cast<const unsigned char*>(data);
+    m_size = st.st_size;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+      std::cerr << "\nError: Couldn't open corpus: " << path;
+      return false;
+    }
+    m_size = file.tellg();
+    // Word buffer keeps the records aligned as they are in a mapping.
+    m_buffer.resize(BoardCorpus::word_count(m_size * 8));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_buffer.data()), m_size);
+    if (!file || m_buffer.empty()) {
+      std::cerr << "\nError: Couldn't read corpus: " << path;
+      m_buffer.clear();
+      return false;
+    }
+    m_data = reinterpret_cast<const unsigned char*>(m_buffer.data());
+    return true;
+#endif
+  }
+
+  // @brief Checks the header and that every record head lies inside the file.
+  // Records themselves aren't touched, so opening doesn't read the whole
+  // file.
+  bool m_validate() {
+    BoardCorpus::Header header;
+    if (m_size < sizeof(header))
+      return false;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, BoardCorpus::MAGIC, sizeof(header.magic)) !=
+            0 ||
+        header.version != BoardCorpus::VERSION ||
+        header.index_offset % 8 != 0 || header.index_offset > m_size ||
+        header.board_count > (m_size - header.index_offset) / 8)
+      return false;
+    m_offsets = reinterpret_cast<const std::uint64_t*>(m_data +
+                                                       header.index_offset);
+    m_board_count = header.board_count;
+    m_index_offset = header.index_offset;
+    for (size_type k = 0; k < m_board_count; ++k) {
+      const auto offset = m_offsets[k];
+      if (offset % 8 != 0 || offset < sizeof(header) ||
+          offset + sizeof(BoardCorpus::Record) > m_index_offset)
+        return false;
+    }
+    return true;
+  }
+};
+
+} // namespace rake
+
+#endif
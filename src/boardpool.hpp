@@ -0,0 +1,270 @@
+#ifndef BOARDPOOL_HPP
+#define BOARDPOOL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "componentcache.hpp"
+#include "mineboard.hpp"
+#include "mineboardsolver.hpp"
+#include "mineraker.hpp"
+#include "philox.hpp"
+
+namespace rake {
+
+/**
+ * @brief Keeps bounded queues of solvable mine layouts for the board
+ * configurations in use. Background threads generate layouts and verify them
+ * with the solver, so the first move can take one without waiting.
+ * @note A layout is solvable when started from any empty tile of the opening
+ * its generator started from. Layouts are mirrored horizontally and
+ * vertically to move that opening under the first opened tile, so a queue of
+ * a few dozen layouts covers nearly every tile of the board.
+ */
+class BoardPool {
+public:
+  using this_type = BoardPool;
+  using seed_type = MineBoard::seed_type;
+
+  struct Config {
+    size_type width;
+    size_type height;
+    size_type mine_count;
+
+    bool operator<(const Config& other) const noexcept {
+      return std::tie(width, height, mine_count) <
+             std::tie(other.width, other.height, other.mine_count);
+    }
+  };
+
+  struct Layout {
+    // Mine of every tile.
+    std::vector<bool> mines;
+    // Empty tiles of the opening which the layout was solved from.
+    std::vector<bool> opening;
+  };
+
+  // Consecutive unsolvable boards after which a configuration is considered
+  // too hard and no longer produced until it is reserved again.
+  static constexpr size_type MAX_FAILED_ATTEMPTS = 10000;
+
+private:
+  struct Queue {
+    std::deque<Layout> layouts;
+    size_type failed_attempts = 0;
+  };
+
+  size_type m_capacity;
+  seed_type m_seed;
+  std::map<Config, Queue> m_queues;
+  std::mutex m_mutex;
+  // Signals producers that a queue has room or that they should stop.
+  std::condition_variable m_cv;
+  bool m_b_stopped;
+  // Scratch space for tiles covered by ready layouts.
+  std::vector<bool> m_covered;
+  // Enumerated frontier components, shared by the producers' solvers.
+  ComponentCache m_cache;
+  std::vector<std::thread> m_producers;
+
+public:
+  // @brief Constructs pool keeping up to %capacity layouts per configuration,
+  // generated by %thread_count threads from boards of series %seed.
+  explicit BoardPool(
+      size_type capacity = 32, unsigned thread_count = 1,
+      seed_type seed =
+          std::chrono::high_resolution_clock::now().time_since_epoch().count())
+      : m_capacity(capacity), m_seed(seed), m_b_stopped(false) {
+    for (unsigned w = 0; w < thread_count; ++w)
+      m_producers.emplace_back([this, w, thread_count] {
+        m_produce(w, thread_count);
+      });
+  }
+  BoardPool(const this_type&) = delete;
+  BoardPool(this_type&&) = delete;
+  ~BoardPool() noexcept { stop(); }
+
+  // @brief Starts keeping layouts of %config available.
+  void reserve(const Config& config) {
+    if (config.width * config.height == 0)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queues[config].failed_attempts = 0;
+    }
+    m_cv.notify_all();
+  }
+
+  // @brief Returns the amount of layouts ready for %config.
+  size_type size(const Config& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_queues.find(config);
+    return it == m_queues.end() ? 0 : it->second.layouts.size();
+  }
+
+  // @brief Lays mines of a ready layout on %board, which waits for its first
+  // move, so that opening %idx is safe and the board solvable from it. Returns
+  // false and leaves %board untouched if no ready layout fits %idx.
+  bool pop(size_type idx, MineBoard& board) {
+    const Config config{board.width(), board.height(), board.mine_count()};
+    if (board.state() != MineBoard::State::FIRST_MOVE ||
+        idx >= board.tile_count())
+      return false;
+    Layout layout;
+    unsigned mirror = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_queues.find(config);
+      if (it == m_queues.end())
+        return false;
+      auto& queue = it->second.layouts;
+      auto fit = queue.end();
+      for (auto l = queue.begin(); l != queue.end() && fit == queue.end(); ++l)
+        for (mirror = 0; mirror < MIRROR_COUNT; ++mirror)
+          if (l->opening[m_mirror(config, idx, mirror)]) {
+            fit = l;
+            break;
+          }
+      if (fit == queue.end())
+        return false;
+      layout = std::move(*fit);
+      queue.erase(fit);
+    }
+    m_cv.notify_all();
+
+    // Mirroring is its own inverse, so tile i of the board is tile
+    // m_mirror(i) of the layout.
+    std::vector<bool> mines(board.tile_count());
+    for (size_type i = 0; i < mines.size(); ++i)
+      mines[i] = layout.mines[m_mirror(config, i, mirror)];
+    board.lay_mines(mines);
+    return true;
+  }
+
+  // @brief Stops and joins the producer threads.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_b_stopped = true;
+    }
+    m_cv.notify_all();
+    for (auto& producer : m_producers)
+      if (producer.joinable())
+        producer.join();
+  }
+
+private:
+  // Identity and horizontal, vertical and both mirrors.
+  static constexpr unsigned MIRROR_COUNT = 4;
+
+  static size_type m_mirror(const Config& config, size_type idx,
+                            unsigned mirror) noexcept {
+    auto x = idx % config.width, y = idx / config.width;
+    if (mirror & 1)
+      x = config.width - 1 - x;
+    if (mirror & 2)
+      y = config.height - 1 - y;
+    return y * config.width + x;
+  }
+
+  // @brief Returns a reserved configuration with the fewest ready layouts if
+  // it has room. Waits for one otherwise. Returns false when stopped.
+  bool m_wait_for_room(std::unique_lock<std::mutex>& lock, Config& config) {
+    for (;;) {
+      if (m_b_stopped)
+        return false;
+      const Queue* emptiest = nullptr;
+      for (const auto& [queue_config, queue] : m_queues)
+        if (queue.layouts.size() < m_capacity &&
+            queue.failed_attempts < MAX_FAILED_ATTEMPTS &&
+            (emptiest == nullptr ||
+             queue.layouts.size() < emptiest->layouts.size())) {
+          emptiest = &queue;
+          config = queue_config;
+        }
+      if (emptiest != nullptr)
+        return true;
+      m_cv.wait(lock);
+    }
+  }
+
+  // @brief Draws a tile which isn't in the opening of any ready layout of
+  // %config with any mirroring. Draws any tile if all of them are.
+  size_type m_uncovered_tile(const Config& config, Philox4x32& rng) {
+    const auto tile_count = config.width * config.height;
+    m_covered.assign(tile_count, false);
+    for (const auto& layout : m_queues[config].layouts)
+      for (size_type i = 0; i < tile_count; ++i)
+        if (layout.opening[i])
+          for (unsigned mirror = 0; mirror < MIRROR_COUNT; ++mirror)
+            m_covered[m_mirror(config, i, mirror)] = true;
+    const auto uncovered = static_cast<size_type>(
+        std::count(m_covered.begin(), m_covered.end(), false));
+    if (uncovered == 0)
+      return static_cast<size_type>(rng.below(tile_count));
+    auto nth = static_cast<size_type>(rng.below(uncovered));
+    for (size_type i = 0;; ++i)
+      if (!m_covered[i] && nth-- == 0)
+        return i;
+  }
+
+  // @brief Generates layouts from boards %w, %w + %thread_count, ... of the
+  // pool's series. Boards are started from tiles which ready layouts don't
+  // cover yet, so that the openings of layouts are spread over the board.
+  void m_produce(unsigned w, unsigned thread_count) {
+    MineBoard board;
+    MineBoardSolver solver(board);
+    solver.cache(&m_cache);
+    board.label_regions(true);
+    // Board streams are counted from zero, so start tiles are drawn from the
+    // other end of the stream range.
+    Philox4x32 rng(m_seed, ~seed_type{w});
+    seed_type k = w;
+
+    Config config;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_wait_for_room(lock, config)) {
+      const auto start = m_uncovered_tile(config, rng);
+      lock.unlock();
+      board.init(config.width, config.height, m_seed, config.mine_count, k);
+      k += thread_count;
+      board.open_tile(start);
+      if (solver.b_solve())
+        solver.open_by_flagged();
+      lock.lock();
+      if (board.state() == MineBoard::State::GAME_WIN)
+        m_push(config, board, start);
+      else
+        ++m_queues[config].failed_attempts;
+    }
+  }
+
+  // @brief Stores the layout of solved %board opened from %start.
+  void m_push(const Config& config, const MineBoard& board, size_type start) {
+    auto& queue = m_queues[config];
+    queue.failed_attempts = 0;
+    if (queue.layouts.size() >= m_capacity)
+      return;
+    Layout layout;
+    layout.mines.resize(board.tile_count());
+    layout.opening.resize(board.tile_count());
+    const auto region = board.m_region_of[start];
+    for (size_type i = 0; i < board.tile_count(); ++i) {
+      layout.mines[i] = board.m_tiles[i].is_mine();
+      layout.opening[i] = region != MineBoard::NO_REGION &&
+                          board.m_region_of[i] == region;
+    }
+    queue.layouts.emplace_back(std::move(layout));
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef BOARDSEARCH_HPP
+#define BOARDSEARCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "componentcache.hpp"
+#include "mineboard.hpp"
+#include "mineboardsolver.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Searches for a board which the solver can finish without guessing.
+ * Boards are numbered by their index in the series generated from a seed and
+ * every worker thread tries a disjoint subset of indexes with its own board
+ * and solver, which are reused from one attempt to the next.
+ * @note Result is the smallest solvable board index, so it doesn't depend on
+ * the amount of threads or their scheduling. Workers stop as soon as every
+ * index below a found one has been tried.
+ */
+class BoardSearch {
+public:
+  using this_type = BoardSearch;
+  using seed_type = MineBoard::seed_type;
+  using clock_type = std::chrono::steady_clock;
+
+  static constexpr seed_type NO_INDEX = std::numeric_limits<seed_type>::max();
+
+  struct Result {
+    // Seed and index of the board in the series.
+    seed_type seed;
+    seed_type board_index;
+    // True if the board was solved. Otherwise it is the board which had the
+    // most tiles opened when the search ran out of time or was cancelled.
+    bool b_solvable;
+    // Tiles opened by the solver on the board.
+    size_type open_count;
+    // Boards tried by all the workers.
+    size_type attempts;
+  };
+
+private:
+  // Best board found by a single worker.
+  struct Candidate {
+    seed_type board_index = NO_INDEX;
+    size_type open_count = 0;
+    size_type attempts = 0;
+  };
+
+  unsigned m_thread_count;
+  // Enumerated frontier components, shared by the workers' solvers.
+  ComponentCache m_cache;
+  // Smallest board index found solvable by any worker.
+  std::atomic<seed_type> m_found;
+  std::atomic<bool> m_b_cancelled;
+
+public:
+  // @brief Constructs search using %thread_count workers. Zero uses a worker
+  // per hardware thread.
+  explicit BoardSearch(unsigned thread_count = 0)
+      : m_thread_count(thread_count), m_found(NO_INDEX),
+        m_b_cancelled(false) {
+    if (m_thread_count == 0)
+      m_thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  BoardSearch(const this_type&) = delete;
+  BoardSearch(this_type&&) = delete;
+  ~BoardSearch() noexcept {}
+
+  // @brief Returns the amount of worker threads.
+  unsigned thread_count() const noexcept { return m_thread_count; }
+
+  // @brief Stops a running search from another thread. The search returns
+  // the best board found so far.
+  void cancel() noexcept { m_b_cancelled = true; }
+
+  // @brief Tries boards of series %seed, opening %start_idx first, until a
+  // solvable one is found or %timeout runs out. Blocks until the workers have
+  // stopped.
+  Result find(size_type width, size_type height, size_type mine_count,
+              size_type start_idx, seed_type seed,
+              clock_type::duration timeout = clock_type::duration::max()) {
+    m_found = NO_INDEX;
+    m_b_cancelled = false;
+    const auto deadline = m_deadline(timeout);
+
+    std::vector<Candidate> candidates(m_thread_count);
+    std::vector<std::thread> workers;
+    workers.reserve(m_thread_count - 1);
+    for (unsigned w = 1; w < m_thread_count; ++w)
+      workers.emplace_back([&, w] {
+        m_work(w, width, height, mine_count, start_idx, seed, deadline,
+               candidates[w]);
+      });
+    m_work(0, width, height, mine_count, start_idx, seed, deadline,
+           candidates[0]);
+    for (auto& worker : workers)
+      worker.join();
+
+    // Solved boards have the most tiles opened, so the best candidate is the
+    // smallest solvable index whenever there is one.
+    Result result{seed, 0, m_found != NO_INDEX, 0, 0};
+    Candidate best;
+    for (const auto& candidate : candidates) {
+      result.attempts += candidate.attempts;
+      if (candidate.board_index == NO_INDEX)
+        continue;
+      if (best.board_index == NO_INDEX ||
+          candidate.open_count > best.open_count ||
+          (candidate.open_count == best.open_count &&
+           candidate.board_index < best.board_index))
+        best = candidate;
+    }
+    if (best.board_index != NO_INDEX) {
+      result.board_index = best.board_index;
+      result.open_count = best.open_count;
+    }
+    return result;
+  }
+
+private:
+  static clock_type::time_point m_deadline(clock_type::duration timeout) {
+    const auto now = clock_type::now();
+    if (timeout >= clock_type::time_point::max() - now)
+      return clock_type::time_point::max();
+    return now + timeout;
+  }
+
+  // @brief Tries board indexes %w, %w + thread count, ... with its own board
+  // and solver.
+  void m_work(unsigned w, size_type width, size_type height,
+              size_type mine_count, size_type start_idx, seed_type seed,
+              clock_type::time_point deadline, Candidate& best) {
+    MineBoard board;
+    MineBoardSolver solver(board);
+    solver.cache(&m_cache);
+    for (seed_type k = w; k < m_found.load(std::memory_order_relaxed);
+         k += m_thread_count) {
+      // Even the first board of a worker is tried before giving up, so that
+      // every search has a candidate.
+      if (best.attempts != 0 &&
+          (m_b_cancelled.load(std::memory_order_relaxed) ||
+           clock_type::now() >= deadline))
+        return;
+      board.init(width, height, seed, mine_count, k);
+      board.open_tile(start_idx);
+      if (solver.b_solve())
+        solver.open_by_flagged();
+      ++best.attempts;
+
+      if (best.board_index == NO_INDEX ||
+          board.open_tiles_count() > best.open_count) {
+        best.board_index = k;
+        best.open_count = board.open_tiles_count();
+      }
+      if (board.state() == MineBoard::State::GAME_WIN) {
+        auto found = m_found.load();
+        while (k < found && !m_found.compare_exchange_weak(found, k))
+          ;
+        return;
+      }
+    }
+  }
+};
+
+} // namespace rake
+
+#endif
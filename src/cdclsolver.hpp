@@ -0,0 +1,470 @@
+#ifndef CDCLSOLVER_HPP
+#define CDCLSOLVER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Small conflict-driven clause learning SAT solver. Variables are
+ * numbered from zero and literal 2v is true when variable v is true, 2v + 1
+ * when it is false. Clauses are watched by two literals, conflicts are learnt
+ * as first unique implication point clauses, decisions follow variable
+ * activity and search restarts in the Luby sequence. Learnt clauses are kept
+ * between calls of %solve, so queries under differing assumptions on the
+ * same clauses get faster as they go.
+ */
+class CdclSolver {
+public:
+  using this_type = CdclSolver;
+  using literal_type = std::uint32_t;
+
+  enum Result { SATISFIABLE, UNSATISFIABLE, UNKNOWN };
+
+  // @brief Returns literal which is true when %var has %b_value.
+  static constexpr literal_type literal(size_type var, bool b_value) noexcept {
+    return static_cast<literal_type>(2 * var + !b_value);
+  }
+
+  static constexpr literal_type negate(literal_type lit) noexcept {
+    return lit ^ 1;
+  }
+
+private:
+  enum Value : unsigned char { FALSE, TRUE, UNDEF };
+
+  // Reason of decided and assumed variables.
+  static constexpr size_type NO_REASON = ~size_type{0};
+  static constexpr size_type NO_VAR = ~size_type{0};
+  // Conflicts between restarts are this many times the Luby sequence.
+  static constexpr size_type RESTART_UNIT = 100;
+  static constexpr double ACTIVITY_DECAY = 0.95;
+
+  struct Clause {
+    // Literals 0 and 1 are watched. Implied literal of a reason is 0.
+    std::vector<literal_type> literals;
+    bool b_learnt;
+  };
+
+  std::vector<Clause> m_clauses;
+  // Clauses watching each literal.
+  std::vector<std::vector<size_type>> m_watches;
+  std::vector<unsigned char> m_values;
+  std::vector<size_type> m_levels;
+  std::vector<size_type> m_reasons;
+  // Value each variable last had, which decisions repeat.
+  std::vector<unsigned char> m_phases;
+  std::vector<unsigned char> m_model;
+
+  // Unassigned variables are kept in a max-heap by activity.
+  std::vector<double> m_activity;
+  double m_increment;
+  std::vector<size_type> m_heap;
+  std::vector<size_type> m_heap_positions;
+
+  std::vector<literal_type> m_trail;
+  // Trail length at the start of each decision level.
+  std::vector<size_type> m_trail_limits;
+  // Trail position of the next literal to propagate.
+  size_type m_head;
+
+  std::vector<unsigned char> m_b_seen;
+  std::vector<literal_type> m_learnt;
+  size_type m_learnt_count;
+  size_type m_max_learnts;
+  // Set once the clauses are found unsatisfiable without assumptions.
+  bool m_b_unsatisfiable;
+
+public:
+  CdclSolver() { clear(); }
+  ~CdclSolver() noexcept {}
+
+  // @brief Removes every variable and clause.
+  void clear() {
+    m_clauses.clear();
+    m_watches.clear();
+    m_values.clear();
+    m_levels.clear();
+    m_reasons.clear();
+    m_phases.clear();
+    m_model.clear();
+    m_activity.clear();
+    m_increment = 1.0;
+    m_heap.clear();
+    m_heap_positions.clear();
+    m_trail.clear();
+    m_trail_limits.clear();
+    m_head = 0;
+    m_b_seen.clear();
+    m_learnt_count = 0;
+    m_max_learnts = 1000;
+    m_b_unsatisfiable = false;
+  }
+
+  // @brief Adds a variable and returns its number.
+  size_type add_variable() {
+    const auto var = m_values.size();
+    m_watches.resize(2 * (var + 1));
+    m_values.emplace_back(UNDEF);
+    m_levels.emplace_back(0);
+    m_reasons.emplace_back(NO_REASON);
+    m_phases.emplace_back(false);
+    m_model.emplace_back(false);
+    m_activity.emplace_back(0.0);
+    m_heap_positions.emplace_back(NO_VAR);
+    m_b_seen.emplace_back(false);
+    m_heap_insert(var);
+    return var;
+  }
+
+  size_type variable_count() const noexcept { return m_values.size(); }
+
+  // @brief Adds clause of %literals. Returns false if the clauses became
+  // unsatisfiable.
+  bool add_clause(std::vector<literal_type> literals) {
+    if (m_b_unsatisfiable)
+      return false;
+    std::sort(literals.begin(), literals.end());
+    literals.erase(std::unique(literals.begin(), literals.end()),
+                   literals.end());
+    // Literals false for good are dropped and true ones satisfy the clause.
+    size_type kept = 0;
+    for (size_type i = 0; i < literals.size(); ++i) {
+      const auto lit = literals[i];
+      if (m_value(lit) == TRUE ||
+          (i + 1 < literals.size() && literals[i + 1] == negate(lit)))
+        return true;
+      if (m_value(lit) == UNDEF)
+        literals[kept++] = lit;
+    }
+    literals.resize(kept);
+    if (literals.empty()) {
+      m_b_unsatisfiable = true;
+      return false;
+    }
+    if (literals.size() == 1) {
+      m_enqueue(literals[0], NO_REASON);
+      m_b_unsatisfiable = m_propagate() != NO_REASON;
+      return !m_b_unsatisfiable;
+    }
+    m_attach(std::move(literals), false);
+    m_max_learnts = std::max<size_type>(1000, m_clauses.size() / 3);
+    return true;
+  }
+
+  // @brief Searches values for the variables which satisfy every clause and
+  // make every literal of %assumptions true. Gives up with %UNKNOWN after
+  // %max_conflicts conflicts.
+  Result solve(const std::vector<literal_type>& assumptions = {},
+               size_type max_conflicts = ~size_type{0}) {
+    if (m_b_unsatisfiable)
+      return UNSATISFIABLE;
+    size_type conflicts = 0, restarts = 0;
+    auto restart_at = RESTART_UNIT * m_luby(restarts);
+    for (;;) {
+      const auto conflict = m_propagate();
+      if (conflict != NO_REASON) {
+        ++conflicts;
+        if (m_trail_limits.empty()) {
+          m_b_unsatisfiable = true;
+          return UNSATISFIABLE;
+        }
+        const auto level = m_analyze(conflict);
+        m_backtrack(level);
+        if (m_learnt.size() == 1)
+          m_enqueue(m_learnt[0], NO_REASON);
+        else {
+          m_attach(m_learnt, true);
+          ++m_learnt_count;
+          m_enqueue(m_learnt[0], m_clauses.size() - 1);
+        }
+        m_increment /= ACTIVITY_DECAY;
+        continue;
+      }
+      if (conflicts >= max_conflicts) {
+        m_backtrack(0);
+        return UNKNOWN;
+      }
+      if (conflicts >= restart_at) {
+        m_backtrack(0);
+        restart_at = conflicts + RESTART_UNIT * m_luby(++restarts);
+        if (m_learnt_count > m_max_learnts)
+          m_reduce();
+        continue;
+      }
+
+      auto next = NO_VAR;
+      while (m_trail_limits.size() < assumptions.size()) {
+        const auto lit = assumptions[m_trail_limits.size()];
+        if (m_value(lit) == TRUE)
+          m_trail_limits.emplace_back(m_trail.size());
+        else if (m_value(lit) == FALSE) {
+          m_backtrack(0);
+          return UNSATISFIABLE;
+        } else {
+          next = lit;
+          break;
+        }
+      }
+      if (next == NO_VAR) {
+        const auto var = m_pick();
+        if (var == NO_VAR) {
+          m_model = m_values;
+          m_backtrack(0);
+          return SATISFIABLE;
+        }
+        next = literal(var, m_phases[var]);
+      }
+      m_trail_limits.emplace_back(m_trail.size());
+      m_enqueue(static_cast<literal_type>(next), NO_REASON);
+    }
+  }
+
+  // @brief Returns value of %var in the solution found by the last
+  // successful %solve.
+  bool model(size_type var) const noexcept { return m_model[var] == TRUE; }
+
+private:
+  Value m_value(literal_type lit) const noexcept {
+    const auto value = m_values[lit >> 1];
+    return value == UNDEF ? UNDEF : static_cast<Value>(value ^ (lit & 1));
+  }
+
+  void m_enqueue(literal_type lit, size_type reason) {
+    const auto var = lit >> 1;
+    m_values[var] = (lit & 1) ? FALSE : TRUE;
+    m_levels[var] = m_trail_limits.size();
+    m_reasons[var] = reason;
+    m_trail.emplace_back(lit);
+  }
+
+  void m_attach(std::vector<literal_type> literals, bool b_learnt) {
+    m_watches[literals[0]].emplace_back(m_clauses.size());
+    m_watches[literals[1]].emplace_back(m_clauses.size());
+    m_clauses.push_back({std::move(literals), b_learnt});
+  }
+
+  // @brief Propagates assigned literals through the clauses watching their
+  // negation. Returns the conflicting clause or %NO_REASON.
+  size_type m_propagate() {
+    while (m_head < m_trail.size()) {
+      const auto false_lit = negate(m_trail[m_head++]);
+      auto& watches = m_watches[false_lit];
+      size_type kept = 0;
+      for (size_type w = 0; w < watches.size(); ++w) {
+        const auto index = watches[w];
+        auto& literals = m_clauses[index].literals;
+        if (literals[0] == false_lit)
+          std::swap(literals[0], literals[1]);
+        if (m_value(literals[0]) == TRUE) {
+          watches[kept++] = index;
+          continue;
+        }
+        bool b_moved = false;
+        for (size_type i = 2; i < literals.size() && !b_moved; ++i)
+          if (m_value(literals[i]) != FALSE) {
+            std::swap(literals[1], literals[i]);
+            m_watches[literals[1]].emplace_back(index);
+            b_moved = true;
+          }
+        if (b_moved)
+          continue;
+        watches[kept++] = index;
+        if (m_value(literals[0]) == FALSE) {
+          while (++w < watches.size())
+            watches[kept++] = watches[w];
+          watches.resize(kept);
+          m_head = m_trail.size();
+          return index;
+        }
+        m_enqueue(literals[0], index);
+      }
+      watches.resize(kept);
+    }
+    return NO_REASON;
+  }
+
+  // @brief Learns the first unique implication point clause of %conflict to
+  // %m_learnt with its asserting literal first. Returns the level to
+  // backtrack to.
+  size_type m_analyze(size_type conflict) {
+    const auto level = m_trail_limits.size();
+    m_learnt.assign(1, 0);
+    size_type pending = 0, position = m_trail.size();
+    auto reason = conflict;
+    auto implied = NO_VAR;
+    do {
+      const auto& literals = m_clauses[reason].literals;
+      for (size_type i = implied == NO_VAR ? 0 : 1; i < literals.size(); ++i) {
+        const auto var = literals[i] >> 1;
+        if (m_b_seen[var] || m_levels[var] == 0)
+          continue;
+        m_b_seen[var] = true;
+        m_bump(var);
+        if (m_levels[var] == level)
+          ++pending;
+        else
+          m_learnt.emplace_back(literals[i]);
+      }
+      while (!m_b_seen[m_trail[--position] >> 1])
+        ;
+      implied = m_trail[position] >> 1;
+      reason = m_reasons[implied];
+      m_b_seen[implied] = false;
+    } while (--pending > 0);
+    m_learnt[0] = negate(m_trail[position]);
+
+    // Second watch goes to the literal of the highest remaining level, which
+    // is the level the clause asserts at.
+    size_type backtrack_level = 0;
+    for (size_type i = 1; i < m_learnt.size(); ++i) {
+      const auto var = m_learnt[i] >> 1;
+      m_b_seen[var] = false;
+      if (m_levels[var] > backtrack_level) {
+        backtrack_level = m_levels[var];
+        std::swap(m_learnt[1], m_learnt[i]);
+      }
+    }
+    return backtrack_level;
+  }
+
+  void m_backtrack(size_type level) {
+    if (m_trail_limits.size() <= level)
+      return;
+    for (auto i = m_trail.size(); i-- > m_trail_limits[level];) {
+      const auto var = m_trail[i] >> 1;
+      m_phases[var] = m_values[var] == TRUE;
+      m_values[var] = UNDEF;
+      if (m_heap_positions[var] == NO_VAR)
+        m_heap_insert(var);
+    }
+    m_trail.resize(m_trail_limits[level]);
+    m_trail_limits.resize(level);
+    m_head = m_trail.size();
+  }
+
+  // @brief Drops the longer half of the learnt clauses. Only called at level
+  // zero, where no clause is needed as a reason.
+  void m_reduce() {
+    std::vector<size_type> lengths;
+    for (const auto& clause : m_clauses)
+      if (clause.b_learnt)
+        lengths.emplace_back(clause.literals.size());
+    auto middle = lengths.begin() + lengths.size() / 2;
+    std::nth_element(lengths.begin(), middle, lengths.end());
+    const auto max_length = *middle;
+    size_type kept = 0;
+    m_learnt_count = 0;
+    for (size_type index = 0; index < m_clauses.size(); ++index) {
+      auto& clause = m_clauses[index];
+      if (clause.b_learnt && clause.literals.size() > max_length)
+        continue;
+      m_learnt_count += clause.b_learnt;
+      if (kept != index)
+        m_clauses[kept] = std::move(clause);
+      ++kept;
+    }
+    m_clauses.resize(kept);
+    for (auto& watches : m_watches)
+      watches.clear();
+    for (size_type index = 0; index < m_clauses.size(); ++index) {
+      m_watches[m_clauses[index].literals[0]].emplace_back(index);
+      m_watches[m_clauses[index].literals[1]].emplace_back(index);
+    }
+    std::fill(m_reasons.begin(), m_reasons.end(), NO_REASON);
+    m_max_learnts += m_max_learnts / 10;
+  }
+
+  // @brief Returns the unassigned variable of the highest activity or
+  // %NO_VAR if every variable is assigned.
+  size_type m_pick() {
+    while (!m_heap.empty()) {
+      const auto var = m_heap_pop();
+      if (m_values[var] == UNDEF)
+        return var;
+    }
+    return NO_VAR;
+  }
+
+  void m_bump(size_type var) {
+    if ((m_activity[var] += m_increment) > 1e100) {
+      for (auto& activity : m_activity)
+        activity *= 1e-100;
+      m_increment *= 1e-100;
+    }
+    if (m_heap_positions[var] != NO_VAR)
+      m_sift_up(m_heap_positions[var]);
+  }
+
+  // @brief Returns the %i-th number of the Luby sequence 1, 1, 2, 1, 1, 2, 4,
+  // 1, 1, 2, ...
+  static size_type m_luby(size_type i) noexcept {
+    size_type size = 1, exponent = 0;
+    while (size < i + 1) {
+      ++exponent;
+      size = 2 * size + 1;
+    }
+    while (size - 1 != i) {
+      size = (size - 1) / 2;
+      --exponent;
+      i %= size;
+    }
+    return size_type{1} << exponent;
+  }
+
+  void m_heap_insert(size_type var) {
+    m_heap_positions[var] = m_heap.size();
+    m_heap.emplace_back(var);
+    m_sift_up(m_heap.size() - 1);
+  }
+
+  size_type m_heap_pop() {
+    const auto top = m_heap.front();
+    m_heap_positions[top] = NO_VAR;
+    m_heap.front() = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+      m_heap_positions[m_heap.front()] = 0;
+      m_sift_down(0);
+    }
+    return top;
+  }
+
+  void m_sift_up(size_type pos) {
+    const auto var = m_heap[pos];
+    while (pos > 0 && m_activity[m_heap[(pos - 1) / 2]] < m_activity[var]) {
+      m_heap[pos] = m_heap[(pos - 1) / 2];
+      m_heap_positions[m_heap[pos]] = pos;
+      pos = (pos - 1) / 2;
+    }
+    m_heap[pos] = var;
+    m_heap_positions[var] = pos;
+  }
+
+  void m_sift_down(size_type pos) {
+    const auto var = m_heap[pos];
+    for (;;) {
+      auto child = 2 * pos + 1;
+      if (child >= m_heap.size())
+        break;
+      if (child + 1 < m_heap.size() &&
+          m_activity[m_heap[child + 1]] > m_activity[m_heap[child]])
+        ++child;
+      if (m_activity[m_heap[child]] <= m_activity[var])
+        break;
+      m_heap[pos] = m_heap[child];
+      m_heap_positions[m_heap[pos]] = pos;
+      pos = child;
+    }
+    m_heap[pos] = var;
+    m_heap_positions[var] = pos;
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef COMPONENTCACHE_HPP
+#define COMPONENTCACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Bounded table of enumerated frontier components, shared by solvers
+ * on any thread. Components are keyed by Zobrist hashes of their
+ * constraints: every constraint and cell of a component is numbered in the
+ * component's own order, each pair of a constraint and one of its cells and
+ * each mine count of a constraint has a pseudorandom value, and a hash is
+ * the XOR of the values. Same local configurations thus get the same key
+ * wherever they are on whichever board.
+ * @note Table is split to shards with their own locks. Each slot of a shard
+ * holds one entry, which a colliding entry replaces. Entries are immutable
+ * and shared, so locks are only held to swap pointers.
+ */
+class ComponentCache {
+public:
+  using this_type = ComponentCache;
+  using hash_type = std::uint64_t;
+
+  struct Key {
+    hash_type hash;
+    // Independent hash to tell apart components whose %hash collides.
+    hash_type check;
+    size_type cell_count;
+  };
+
+  // Enumeration results of a component.
+  struct Entry {
+    Key key;
+    bool b_complete;
+    // Solutions by their amount of mines.
+    std::vector<double> counts;
+    // Solutions with k mines in which the cell at position i is a mine are
+    // counted at (k - %first_amount) * %key.cell_count + i, for the amounts
+    // from %first_amount to the largest one with solutions.
+    size_type first_amount;
+    std::vector<double> mine_counts;
+  };
+
+  using entry_pointer = std::shared_ptr<const Entry>;
+
+  static constexpr size_type SHARD_COUNT = 64;
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::vector<entry_pointer> entries;
+  };
+
+  std::array<Shard, SHARD_COUNT> m_shards;
+  std::atomic<size_type> m_hits;
+  std::atomic<size_type> m_misses;
+
+public:
+  // @brief Constructs cache of about %capacity entries.
+  explicit ComponentCache(size_type capacity = 1 << 14)
+      : m_hits(0), m_misses(0) {
+    for (auto& shard : m_shards)
+      shard.entries.resize(std::max<size_type>(1, capacity / SHARD_COUNT));
+  }
+  ComponentCache(const this_type&) = delete;
+  ~ComponentCache() noexcept {}
+
+  // @brief Returns the pseudorandom value of %feature for hashes of %salt.
+  static constexpr hash_type zobrist(hash_type feature,
+                                     hash_type salt) noexcept {
+    // SplitMix64 finalizer.
+    auto z = feature * 0x9E3779B97F4A7C15ull + salt;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  // @brief Returns the entry of the component of %key, or null if the
+  // component isn't in the cache.
+  entry_pointer find(const Key& key) {
+    auto& shard = m_shard(key);
+    entry_pointer entry;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      entry = m_slot(shard, key);
+    }
+    if (entry != nullptr && m_b_same(entry->key, key)) {
+      m_hits.fetch_add(1, std::memory_order_relaxed);
+      return entry;
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  // @brief Stores the solution counts of the component of %key. Solutions
+  // with k mines in which the cell at position i is a mine are counted in
+  // %mine_counts[k][i], which is empty for amounts without solutions.
+  void insert(const Key& key, const std::vector<double>& counts,
+              const std::vector<std::vector<double>>& mine_counts,
+              bool b_complete) {
+    auto entry = std::make_shared<Entry>();
+    entry->key = key;
+    entry->b_complete = b_complete;
+    entry->counts = counts;
+    size_type first = 0, end = counts.size();
+    while (first < end && counts[first] == 0.0)
+      ++first;
+    while (end > first && counts[end - 1] == 0.0)
+      --end;
+    entry->first_amount = first;
+    entry->mine_counts.assign((end - first) * key.cell_count, 0.0);
+    for (auto k = first; k < end; ++k)
+      if (!mine_counts[k].empty())
+        std::copy(mine_counts[k].begin(), mine_counts[k].end(),
+                  entry->mine_counts.begin() + (k - first) * key.cell_count);
+
+    auto& shard = m_shard(key);
+    entry_pointer replaced = std::move(entry);
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      m_slot(shard, key).swap(replaced);
+    }
+  }
+
+  // @brief Removes every entry.
+  void clear() {
+    for (auto& shard : m_shards) {
+      std::vector<entry_pointer> entries(shard.entries.size());
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.swap(entries);
+      }
+    }
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  // @brief Returns the amount of lookups which found their component.
+  size_type hits() const noexcept { return m_hits; }
+
+  size_type misses() const noexcept { return m_misses; }
+
+private:
+  Shard& m_shard(const Key& key) noexcept {
+    return m_shards[key.hash % SHARD_COUNT];
+  }
+
+  static entry_pointer& m_slot(Shard& shard, const Key& key) noexcept {
+    return shard.entries[(key.hash / SHARD_COUNT) % shard.entries.size()];
+  }
+
+  static bool m_b_same(const Key& a, const Key& b) noexcept {
+    return a.hash == b.hash && a.check == b.check &&
+           a.cell_count == b.cell_count;
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef FRONTIER_HPP
+#define FRONTIER_HPP
+
+#include <vector>
+
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Unknown tiles of a board as constraints, apart from the board.
+ * Every open numbered tile with unknown neighbours is a constraint on those
+ * neighbours. Unknown tiles next to a constraint are the frontier cells and
+ * the rest are interior tiles, which only the total mine count constrains.
+ * Solvers read the frontier once %link has been called.
+ */
+struct Frontier {
+  // Board tiles of the frontier cells.
+  std::vector<size_type> cells;
+  // Cells of constraint k are stored in %constraint_cells at range
+  // [constraint_offsets[k], constraint_offsets[k + 1]).
+  std::vector<size_type> constraint_offsets;
+  std::vector<size_type> constraint_cells;
+  // Amount of mines among the cells of each constraint.
+  std::vector<int> constraint_mines;
+  // Board tiles of the interior.
+  std::vector<size_type> interior;
+  // Amount of mines among all unknown tiles.
+  size_type mines_left = 0;
+
+  // Built from the constraints by %link.
+  // Constraints of cell i are stored in %cell_constraints at range
+  // [cell_offsets[i], cell_offsets[i + 1]).
+  std::vector<size_type> cell_offsets;
+  std::vector<size_type> cell_constraints;
+  // Cells of independent component c, which share no constraints with other
+  // components, are stored in %component_cells at range
+  // [component_offsets[c], component_offsets[c + 1]) in breadth-first order.
+  // Cells sharing a constraint are close to each other in it.
+  std::vector<size_type> component_offsets;
+  std::vector<size_type> component_cells;
+
+  void clear() {
+    cells.clear();
+    constraint_offsets.assign(1, 0);
+    constraint_cells.clear();
+    constraint_mines.clear();
+    interior.clear();
+    mines_left = 0;
+    cell_offsets.clear();
+    cell_constraints.clear();
+    component_offsets.assign(1, 0);
+    component_cells.clear();
+  }
+
+  size_type constraint_count() const noexcept {
+    return constraint_mines.size();
+  }
+
+  size_type component_count() const noexcept {
+    return component_offsets.size() - 1;
+  }
+
+  // @brief Builds the constraints of each cell and the components from the
+  // cells of each constraint.
+  void link() {
+    cell_offsets.assign(cells.size() + 1, 0);
+    for (auto cell : constraint_cells)
+      ++cell_offsets[cell + 1];
+    for (size_type i = 0; i + 1 < cell_offsets.size(); ++i)
+      cell_offsets[i + 1] += cell_offsets[i];
+    cell_constraints.resize(constraint_cells.size());
+    auto next = cell_offsets;
+    for (size_type k = 0; k < constraint_count(); ++k)
+      for (auto c = constraint_offsets[k]; c < constraint_offsets[k + 1]; ++c)
+        cell_constraints[next[constraint_cells[c]]++] = k;
+
+    component_offsets.assign(1, 0);
+    component_cells.clear();
+    std::vector<unsigned char> b_visited(cells.size(), false);
+    for (size_type first = 0; first < cells.size(); ++first) {
+      if (b_visited[first])
+        continue;
+      b_visited[first] = true;
+      component_cells.emplace_back(first);
+      for (auto next = component_offsets.back(); next < component_cells.size();
+           ++next) {
+        const auto cell = component_cells[next];
+        for (auto k = cell_offsets[cell]; k < cell_offsets[cell + 1]; ++k) {
+          const auto constraint = cell_constraints[k];
+          for (auto c = constraint_offsets[constraint];
+               c < constraint_offsets[constraint + 1]; ++c)
+            if (!b_visited[constraint_cells[c]]) {
+              b_visited[constraint_cells[c]] = true;
+              component_cells.emplace_back(constraint_cells[c]);
+            }
+        }
+      }
+      component_offsets.emplace_back(component_cells.size());
+    }
+  }
+};
+
+} // namespace rake
+
+#endif
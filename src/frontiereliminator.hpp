@@ -0,0 +1,261 @@
+#ifndef FRONTIERELIMINATOR_HPP
+#define FRONTIERELIMINATOR_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "frontier.hpp"
+#include "frontierenumerator.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Decides frontier cells by Gaussian elimination of the constraints.
+ * Each constraint is a row of coefficients over the cells of its component
+ * with the amount of mines as its value. Rows are reduced by adding and
+ * subtracting them, a word of cells at a time, and a reduced row decides its
+ * cells when its value can only be reached one way: all cells with
+ * coefficient 1 are mines and those with -1 are safe, or the other way
+ * around. Unlike pairs of constraints, rows combine constraints along the
+ * whole component, but they don't see every deduction enumeration does.
+ */
+class FrontierEliminator {
+public:
+  using this_type = FrontierEliminator;
+  using Verdict = FrontierEnumerator::Verdict;
+  using clock_type = FrontierEnumerator::clock_type;
+
+private:
+  using word_type = std::uint64_t;
+
+  static constexpr size_type WORD_BITS = 64;
+  static constexpr size_type NO_COLUMN = ~size_type{0};
+  // Columns eliminated between checks of the deadline.
+  static constexpr size_type DEADLINE_COLUMNS = 64;
+
+  // Row of coefficients -1, 0 and 1, stored as masks of the columns with
+  // coefficient 1 and -1. Masks cover the words from %first on.
+  struct Row {
+    size_type first;
+    std::vector<word_type> plus;
+    std::vector<word_type> minus;
+    int value;
+  };
+
+  std::vector<Verdict> m_verdicts;
+  std::vector<Row> m_rows;
+  // Position of each cell in its component, which is its column.
+  std::vector<size_type> m_columns;
+  // Component of each cell.
+  std::vector<size_type> m_component_of;
+  // Constraints of component c are stored in %m_constraints at range
+  // [m_constraint_offsets[c], m_constraint_offsets[c + 1]).
+  std::vector<size_type> m_constraint_offsets;
+  std::vector<size_type> m_constraints;
+  std::vector<unsigned char> m_b_pivot;
+
+public:
+  FrontierEliminator() {}
+  ~FrontierEliminator() noexcept {}
+
+  // @brief Reduces the constraints of linked %frontier. Returns false if the
+  // constraints contradict each other, which happens when some flag is
+  // misplaced. Elimination stops once %deadline has passed, and cells are
+  // decided from rows reduced that far, which are still sound.
+  bool solve(const Frontier& frontier,
+             clock_type::time_point deadline = clock_type::time_point::max()) {
+    m_verdicts.assign(frontier.cells.size(), FrontierEnumerator::UNDECIDED);
+    m_columns.resize(frontier.cells.size());
+    m_component_of.resize(frontier.cells.size());
+    for (size_type c = 0; c < frontier.component_count(); ++c)
+      for (auto i = frontier.component_offsets[c];
+           i < frontier.component_offsets[c + 1]; ++i) {
+        m_columns[frontier.component_cells[i]] =
+            i - frontier.component_offsets[c];
+        m_component_of[frontier.component_cells[i]] = c;
+      }
+
+    // Constraints are sorted by component, counting them first.
+    m_constraint_offsets.assign(frontier.component_count() + 1, 0);
+    for (size_type k = 0; k < frontier.constraint_count(); ++k)
+      ++m_constraint_offsets[m_component_of[m_first_cell(frontier, k)] + 1];
+    for (size_type c = 0; c < frontier.component_count(); ++c)
+      m_constraint_offsets[c + 1] += m_constraint_offsets[c];
+    m_constraints.resize(frontier.constraint_count());
+    auto next = m_constraint_offsets;
+    for (size_type k = 0; k < frontier.constraint_count(); ++k)
+      m_constraints[next[m_component_of[m_first_cell(frontier, k)]]++] = k;
+
+    for (size_type c = 0; c < frontier.component_count(); ++c)
+      if (!m_b_solve_component(frontier, c, deadline))
+        return false;
+    return true;
+  }
+
+  // @brief Returns the verdict on frontier cell %i.
+  Verdict cell(size_type i) const noexcept { return m_verdicts[i]; }
+
+private:
+  static size_type m_first_cell(const Frontier& frontier, size_type k) {
+    return frontier.constraint_cells[frontier.constraint_offsets[k]];
+  }
+
+  bool m_b_solve_component(const Frontier& frontier, size_type c,
+                           clock_type::time_point deadline) {
+    const auto offset = frontier.component_offsets[c];
+    const auto size = frontier.component_offsets[c + 1] - offset;
+    m_rows.clear();
+    for (auto r = m_constraint_offsets[c]; r < m_constraint_offsets[c + 1];
+         ++r) {
+      const auto k = m_constraints[r];
+      auto first = NO_COLUMN, last = size_type{0};
+      for (auto i = frontier.constraint_offsets[k];
+           i < frontier.constraint_offsets[k + 1]; ++i) {
+        const auto column = m_columns[frontier.constraint_cells[i]];
+        first = std::min(first, column / WORD_BITS);
+        last = std::max(last, column / WORD_BITS);
+      }
+      m_rows.push_back({first, std::vector<word_type>(last - first + 1, 0),
+                        std::vector<word_type>(last - first + 1, 0),
+                        frontier.constraint_mines[k]});
+      auto& row = m_rows.back();
+      for (auto i = frontier.constraint_offsets[k];
+           i < frontier.constraint_offsets[k + 1]; ++i) {
+        const auto column = m_columns[frontier.constraint_cells[i]];
+        row.plus[column / WORD_BITS - first] |= word_type{1}
+                                                << (column % WORD_BITS);
+      }
+    }
+
+    // Each column is eliminated from every other row by a pivot row which
+    // has it. Rows where this would leave a coefficient of 2 or -2 keep the
+    // column.
+    m_b_pivot.assign(m_rows.size(), false);
+    for (size_type column = 0; column < size; ++column) {
+      if (column % DEADLINE_COLUMNS == 0 &&
+          deadline != clock_type::time_point::max() &&
+          clock_type::now() >= deadline)
+        break;
+      auto pivot = m_rows.size();
+      for (size_type r = 0; r < m_rows.size(); ++r)
+        if (!m_b_pivot[r] && m_coefficient(m_rows[r], column) != 0 &&
+            (pivot == m_rows.size() ||
+             m_rows[r].plus.size() < m_rows[pivot].plus.size()))
+          pivot = r;
+      if (pivot == m_rows.size())
+        continue;
+      m_b_pivot[pivot] = true;
+      const auto sign = m_coefficient(m_rows[pivot], column);
+      for (size_type r = 0; r < m_rows.size(); ++r) {
+        const auto coefficient = m_coefficient(m_rows[r], column);
+        if (r != pivot && coefficient != 0)
+          m_b_add(m_rows[r], m_rows[pivot], -coefficient * sign);
+      }
+    }
+
+    for (const auto& row : m_rows)
+      if (!m_b_decide(frontier, offset, row))
+        return false;
+    return true;
+  }
+
+  static int m_coefficient(const Row& row, size_type column) noexcept {
+    const auto word = column / WORD_BITS;
+    if (word < row.first || word >= row.first + row.plus.size())
+      return 0;
+    const auto bit = word_type{1} << (column % WORD_BITS);
+    return (row.plus[word - row.first] & bit) ? 1
+           : (row.minus[word - row.first] & bit) ? -1
+                                                  : 0;
+  }
+
+  // @brief Adds %source times %sign to %target. Returns false and leaves
+  // %target as it was if some coefficient would become 2 or -2.
+  static bool m_b_add(Row& target, const Row& source, int sign) {
+    const auto& source_plus = sign > 0 ? source.plus : source.minus;
+    const auto& source_minus = sign > 0 ? source.minus : source.plus;
+    const auto source_end = source.first + source.plus.size();
+    for (auto word = std::max(target.first, source.first);
+         word < std::min(target.first + target.plus.size(), source_end);
+         ++word) {
+      const auto t = word - target.first, s = word - source.first;
+      if ((target.plus[t] & source_plus[s]) |
+          (target.minus[t] & source_minus[s]))
+        return false;
+    }
+
+    // Target is widened to cover the source.
+    const auto first = std::min(target.first, source.first);
+    const auto end =
+        std::max(target.first + target.plus.size(), source_end);
+    target.plus.insert(target.plus.begin(), target.first - first, 0);
+    target.minus.insert(target.minus.begin(), target.first - first, 0);
+    target.plus.resize(end - first, 0);
+    target.minus.resize(end - first, 0);
+    target.first = first;
+    for (auto word = source.first; word < source_end; ++word) {
+      const auto t = word - target.first, s = word - source.first;
+      const auto plus = target.plus[t], minus = target.minus[t];
+      target.plus[t] = (plus ^ source_plus[s]) & ~(minus | source_minus[s]);
+      target.minus[t] = (minus ^ source_minus[s]) & ~(plus | source_plus[s]);
+    }
+    target.value += sign * source.value;
+
+    // Zero words at either end are dropped.
+    size_type lead = 0;
+    while (lead < target.plus.size() && (target.plus[lead] |
+                                         target.minus[lead]) == 0)
+      ++lead;
+    auto trail = target.plus.size();
+    while (trail > lead && (target.plus[trail - 1] |
+                            target.minus[trail - 1]) == 0)
+      --trail;
+    target.plus.erase(target.plus.begin() + trail, target.plus.end());
+    target.minus.erase(target.minus.begin() + trail, target.minus.end());
+    target.plus.erase(target.plus.begin(), target.plus.begin() + lead);
+    target.minus.erase(target.minus.begin(), target.minus.begin() + lead);
+    target.first += lead;
+    return true;
+  }
+
+  // @brief Decides the cells of %row if its value can only be reached one
+  // way. Returns false if it can't be reached or the row contradicts earlier
+  // verdicts.
+  bool m_b_decide(const Frontier& frontier, size_type offset,
+                  const Row& row) {
+    int plus = 0, minus = 0;
+    for (size_type w = 0; w < row.plus.size(); ++w) {
+      plus += static_cast<int>(bit_count(row.plus[w]));
+      minus += static_cast<int>(bit_count(row.minus[w]));
+    }
+    if (row.value > plus || row.value < -minus)
+      return false;
+    if (row.value != plus && row.value != -minus)
+      return true;
+    const bool b_plus_mines = row.value == plus;
+    for (size_type w = 0; w < row.plus.size(); ++w)
+      for (int b_plus = 0; b_plus < 2; ++b_plus) {
+        const auto verdict = (b_plus != 0) == b_plus_mines
+                                 ? FrontierEnumerator::MINE
+                                 : FrontierEnumerator::SAFE;
+        for (auto bits = b_plus ? row.plus[w] : row.minus[w]; bits != 0;
+             bits &= bits - 1) {
+          const auto column = (row.first + w) * WORD_BITS + bit_scan(bits);
+          auto& cell_verdict =
+              m_verdicts[frontier.component_cells[offset + column]];
+          if (cell_verdict != FrontierEnumerator::UNDECIDED &&
+              cell_verdict != verdict)
+            return false;
+          cell_verdict = verdict;
+        }
+      }
+    return true;
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,813 @@
+#ifndef FRONTIERENUMERATOR_HPP
+#define FRONTIERENUMERATOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "componentcache.hpp"
+#include "frontier.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Finds what every solution of a %Frontier agrees on. Frontier is
+ * split into components of cells linked by shared constraints and each
+ * component is enumerated on its own by backtracking, pruned as soon as a
+ * constraint can't be met. Components are then combined under the total
+ * mine count, with the interior taking up the rest of the mines.
+ * @note Enumeration of a component is given up after %MAX_STEPS steps or
+ * once the deadline has passed. Such a component is taken to allow any
+ * amount of mines, so the other verdicts stay sound.
+ */
+class FrontierEnumerator {
+public:
+  using this_type = FrontierEnumerator;
+  using clock_type = std::chrono::steady_clock;
+
+  // What every solution says of a tile.
+  enum Verdict : unsigned char {
+    UNDECIDED,
+    SAFE,
+    MINE,
+  };
+
+  // Search steps after which enumeration of a component is given up.
+  static constexpr size_type MAX_STEPS = size_type{1} << 22;
+  // Components of at least this many cells are enumerated with multiple
+  // threads, if the enumerator has them.
+  static constexpr size_type PARALLEL_CELLS = 32;
+  // Components of at most this many cells are looked up from and stored to
+  // the cache, if the enumerator has one. Larger ones rarely recur.
+  static constexpr size_type CACHE_CELLS = 64;
+
+private:
+  // Largest exponent of a scaled weight, which keeps the weights finite.
+  static constexpr double MAX_EXPONENT = 700.0;
+  // Steps a worker takes before adding them to the shared step count.
+  static constexpr size_type STEP_BATCH = 1024;
+  static constexpr size_type NO_NUMBER = ~size_type{0};
+  static constexpr ComponentCache::hash_type HASH_SALT = 0x6D696E6573ull;
+  static constexpr ComponentCache::hash_type CHECK_SALT = 0x72616B65ull;
+
+  using bits_type = std::vector<std::uint64_t>;
+
+  struct Component {
+    // Cells in enumeration order. Cells sharing a constraint are close to
+    // each other, so constraints are completed and pruned early.
+    std::vector<size_type> cells;
+    // Solutions by their amount of mines.
+    std::vector<double> counts;
+    // Solutions with k mines in which the cell at position i is a mine are
+    // counted in mine_counts[k][i]. Allocated for the seen mine amounts.
+    std::vector<std::vector<double>> mine_counts;
+    bool b_complete;
+  };
+
+  std::vector<Component> m_components;
+  // Weight of each mine amount of each component for %probabilities.
+  std::vector<std::vector<double>> m_weights;
+  std::vector<Verdict> m_verdicts;
+  Verdict m_interior;
+
+  const Frontier* m_frontier;
+  ComponentCache* m_cache;
+  // Position of each cell in its component and number of each constraint
+  // in its component, in the order of the cells, for cache keys.
+  std::vector<size_type> m_positions;
+  std::vector<size_type> m_constraint_numbers;
+
+  // Search state and solution counts of a thread enumerating a component.
+  struct Worker {
+    // Mines placed and cells not yet assigned for each constraint.
+    std::vector<int> placed;
+    std::vector<int> unassigned;
+    // Current assignment by position in the component.
+    std::vector<unsigned char> assignment;
+    std::vector<double> counts;
+    std::vector<std::vector<double>> mine_counts;
+    // Steps not yet added to %m_steps.
+    size_type steps;
+    // Subtrees left to search, each given by the assignment of the first
+    // cells of the component. Owner takes from the back and others steal
+    // from the front.
+    std::deque<std::vector<unsigned char>> tasks;
+    std::mutex mutex;
+  };
+
+  unsigned m_thread_count;
+  // Worker 0 is used by the calling thread and for serial enumeration.
+  std::deque<Worker> m_workers;
+  // Threads of the other workers. Started on the first large component and
+  // kept across components and calls to %solve until the thread count
+  // changes.
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  // Signals the threads that a component is ready or that they should stop.
+  std::condition_variable m_cv;
+  // Signals the calling thread that the threads are done with a component.
+  std::condition_variable m_done_cv;
+  bool m_b_stopped;
+  // Counts components handed to the threads.
+  size_type m_round;
+  // Threads still working on the current component.
+  size_type m_busy;
+  const Component* m_component;
+  // Steps taken on the current component by all workers.
+  std::atomic<size_type> m_steps;
+  std::atomic<bool> m_b_given_up;
+  clock_type::time_point m_deadline;
+
+public:
+  // @brief Constructs enumerator using %thread_count threads on large
+  // components. Zero uses a thread per hardware thread.
+  explicit FrontierEnumerator(unsigned thread_count = 1)
+      : m_interior(UNDECIDED), m_frontier(nullptr), m_cache(nullptr),
+        m_thread_count(0), m_b_stopped(false), m_round(0), m_busy(0),
+        m_component(nullptr), m_steps(0), m_b_given_up(false),
+        m_deadline(clock_type::time_point::max()) {
+    this->thread_count(thread_count);
+  }
+  FrontierEnumerator(const this_type&) = delete;
+  ~FrontierEnumerator() noexcept { m_stop(); }
+
+  // @brief Sets the amount of threads used on large components. Zero uses a
+  // thread per hardware thread.
+  void thread_count(unsigned thread_count) {
+    if (thread_count == 0)
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    if (thread_count == m_thread_count)
+      return;
+    m_stop();
+    m_thread_count = thread_count;
+    m_workers.resize(m_thread_count);
+  }
+
+  // @brief Returns the amount of threads used on large components.
+  unsigned thread_count() const noexcept { return m_thread_count; }
+
+  // @brief Makes the enumerator reuse results of small components from
+  // %cache and store its own to it. Null disables caching.
+  void cache(ComponentCache* cache) noexcept { m_cache = cache; }
+
+  ComponentCache* cache() const noexcept { return m_cache; }
+
+  // @brief Makes enumeration give up on components once %deadline has
+  // passed. Components given up on this way aren't stored to the cache.
+  void deadline(clock_type::time_point deadline) noexcept {
+    m_deadline = deadline;
+  }
+
+  clock_type::time_point deadline() const noexcept { return m_deadline; }
+
+  // @brief Enumerates the solutions of linked %frontier. Returns false if it
+  // has none, which happens when some flag is misplaced.
+  bool solve(const Frontier& frontier) {
+    m_frontier = &frontier;
+    m_verdicts.assign(frontier.cells.size(), UNDECIDED);
+    m_interior = UNDECIDED;
+    m_components.resize(frontier.component_count());
+    const auto cells = frontier.component_cells.begin();
+    for (size_type c = 0; c < m_components.size(); ++c)
+      m_components[c].cells.assign(cells + frontier.component_offsets[c],
+                                   cells + frontier.component_offsets[c + 1]);
+    // Search leaves these as they were, so they are set once for all
+    // components. Other workers copy them when they are needed.
+    auto& worker = m_workers.front();
+    worker.placed.assign(frontier.constraint_count(), 0);
+    worker.unassigned.resize(frontier.constraint_count());
+    for (size_type k = 0; k < frontier.constraint_count(); ++k)
+      worker.unassigned[k] = static_cast<int>(
+          frontier.constraint_offsets[k + 1] - frontier.constraint_offsets[k]);
+    if (m_cache != nullptr) {
+      m_positions.resize(frontier.cells.size());
+      m_constraint_numbers.assign(frontier.constraint_count(), NO_NUMBER);
+    }
+    for (auto& component : m_components) {
+      const bool b_cached =
+          m_cache != nullptr && component.cells.size() <= CACHE_CELLS;
+      ComponentCache::Key key{};
+      if (b_cached) {
+        key = m_key(component);
+        if (const auto entry = m_cache->find(key)) {
+          m_load(component, *entry);
+          if (!m_b_solvable(component))
+            return false;
+          continue;
+        }
+      }
+      m_enumerate(component);
+      // Results cut short by the deadline are only good for this call.
+      if (b_cached && (component.b_complete || !m_b_past_deadline()))
+        m_cache->insert(key, component.counts, component.mine_counts,
+                        component.b_complete);
+      if (!m_b_solvable(component))
+        return false;
+    }
+    return m_combine();
+  }
+
+  // @brief Returns the verdict on frontier cell %i.
+  Verdict cell(size_type i) const noexcept { return m_verdicts[i]; }
+
+  // @brief Returns the verdict on every interior tile.
+  Verdict interior() const noexcept { return m_interior; }
+
+  // @brief Returns the amount of independent components of the frontier.
+  size_type component_count() const noexcept { return m_components.size(); }
+
+  // @brief Stores the cells of the components whose enumeration was given up
+  // to %cells.
+  void incomplete_cells(std::vector<size_type>& cells) const {
+    cells.clear();
+    for (const auto& component : m_components)
+      if (!component.b_complete)
+        cells.insert(cells.end(), component.cells.begin(),
+                     component.cells.end());
+  }
+
+  // @brief Stores the mine probability of each frontier cell to %cells and
+  // that of every interior tile to %interior, for the frontier of the last
+  // successful %solve. Every layout of mines fitting the frontier is taken
+  // to be equally likely. Returns false if enumeration of some component was
+  // given up.
+  bool probabilities(std::vector<double>& cells, double& interior) {
+    for (const auto& component : m_components)
+      if (!component.b_complete)
+        return false;
+    const auto& frontier = *m_frontier;
+    const auto mines = static_cast<std::int64_t>(frontier.mines_left),
+               interior_count =
+                   static_cast<std::int64_t>(frontier.interior.size());
+    const auto count = m_components.size();
+
+    // Each sum of component mines is weighted by the ways to lay the rest of
+    // the mines in the interior. Binomials are compared in log-space, as
+    // they overflow on large boards, and scaled so that the largest term is
+    // one.
+    std::vector<double> sums;
+    m_product(0, count, sums);
+    const auto log_ways = [&](std::int64_t sum) {
+      const auto rest = mines - sum;
+      if (rest < 0 || rest > interior_count)
+        return -std::numeric_limits<double>::infinity();
+      return std::lgamma(interior_count + 1.0) - std::lgamma(rest + 1.0) -
+             std::lgamma(interior_count - rest + 1.0);
+    };
+    auto shift = -std::numeric_limits<double>::infinity();
+    for (size_type t = 0; t < sums.size(); ++t)
+      if (sums[t] > 0.0)
+        shift = std::max(shift, log_ways(t) + std::log(sums[t]));
+    if (shift == -std::numeric_limits<double>::infinity())
+      return false;
+    std::vector<double> weights(sums.size(), 0.0);
+    double total = 0.0, interior_mines = 0.0;
+    for (size_type t = 0; t < sums.size(); ++t) {
+      if (sums[t] > 0.0)
+        weights[t] = std::exp(std::min(log_ways(t) - shift, MAX_EXPONENT));
+      total += sums[t] * weights[t];
+      interior_mines += sums[t] * weights[t] * (mines - t);
+    }
+    interior = interior_count > 0 ? interior_mines / total / interior_count
+                                  : 0.0;
+
+    m_weights.resize(count);
+    m_distribute(0, count, weights);
+    cells.assign(m_verdicts.size(), 0.0);
+    for (size_type c = 0; c < count; ++c) {
+      const auto& component = m_components[c];
+      const auto size = component.cells.size();
+      double norm = 0.0;
+      for (size_type k = 0; k <= size; ++k) {
+        if (component.counts[k] == 0.0)
+          continue;
+        const auto weight = m_weights[c][k];
+        norm += component.counts[k] * weight;
+        const auto& mine_counts = component.mine_counts[k];
+        for (size_type pos = 0; pos < size; ++pos)
+          cells[component.cells[pos]] += mine_counts[pos] * weight;
+      }
+      for (auto cell : component.cells)
+        cells[cell] = norm > 0.0 ? cells[cell] / norm : 0.0;
+    }
+    return true;
+  }
+
+private:
+  // @brief Counts the solutions of %component by their amount of mines.
+  void m_enumerate(Component& component) {
+    const auto size = component.cells.size();
+    m_steps = 0;
+    m_b_given_up = false;
+    if (m_thread_count > 1 && size >= PARALLEL_CELLS)
+      m_enumerate_parallel(component);
+    else {
+      auto& worker = m_workers.front();
+      m_reset(worker, size);
+      m_search(worker, component, 0, 0);
+      m_add_steps(worker);
+      component.counts.swap(worker.counts);
+      component.mine_counts.swap(worker.mine_counts);
+    }
+    component.b_complete = !m_b_given_up;
+  }
+
+  // @brief Copies the solution counts of cached %entry to %component.
+  static void m_load(Component& component,
+                     const ComponentCache::Entry& entry) {
+    const auto size = component.cells.size();
+    component.b_complete = entry.b_complete;
+    component.counts = entry.counts;
+    component.mine_counts.resize(size + 1);
+    for (size_type k = 0; k <= size; ++k) {
+      auto& mine_counts = component.mine_counts[k];
+      if (component.counts[k] == 0.0) {
+        mine_counts.clear();
+        continue;
+      }
+      const auto row = entry.mine_counts.begin() +
+                       (k - entry.first_amount) * size;
+      mine_counts.assign(row, row + size);
+    }
+  }
+
+  // @brief Returns false if a fully enumerated %component has no solutions.
+  static bool m_b_solvable(const Component& component) {
+    return !component.b_complete ||
+           std::any_of(component.counts.begin(), component.counts.end(),
+                       [](double count) { return count > 0.0; });
+  }
+
+  // @brief Returns the cache key of %component. Constraints are numbered by
+  // their first cell in the component, which doesn't depend on where the
+  // component is.
+  ComponentCache::Key m_key(const Component& component) {
+    const auto& frontier = *m_frontier;
+    const auto size = component.cells.size();
+    for (size_type pos = 0; pos < size; ++pos)
+      m_positions[component.cells[pos]] = pos;
+    ComponentCache::Key key{0, 0, size};
+    const auto add = [&key](ComponentCache::hash_type feature) {
+      key.hash ^= ComponentCache::zobrist(feature, HASH_SALT);
+      key.check ^= ComponentCache::zobrist(feature, CHECK_SALT);
+    };
+    size_type number = 0;
+    for (auto cell : component.cells)
+      for (auto k = frontier.cell_offsets[cell];
+           k < frontier.cell_offsets[cell + 1]; ++k) {
+        const auto constraint = frontier.cell_constraints[k];
+        if (m_constraint_numbers[constraint] != NO_NUMBER)
+          continue;
+        m_constraint_numbers[constraint] = number;
+        // Features are the constraint's number in the high half and either
+        // a position or the mine count, told apart by the lowest bit.
+        const ComponentCache::hash_type high =
+            static_cast<ComponentCache::hash_type>(number++) << 32;
+        add(high | (static_cast<ComponentCache::hash_type>(
+                        frontier.constraint_mines[constraint])
+                    << 1) |
+            1);
+        for (auto c = frontier.constraint_offsets[constraint];
+             c < frontier.constraint_offsets[constraint + 1]; ++c)
+          add(high | (m_positions[frontier.constraint_cells[c]] << 1));
+      }
+    return key;
+  }
+
+  // @brief Splits the search tree of %component to subtrees which the
+  // workers take turns on, stealing from each other when they run out.
+  void m_enumerate_parallel(Component& component) {
+    const auto size = component.cells.size();
+    auto& first = m_workers.front();
+    m_reset(first, size);
+    // Subtrees at this depth outnumber the workers enough to even out their
+    // differing sizes. Threads are idle between components, so the tasks
+    // are dealt out without locking.
+    size_type depth = 0;
+    while (depth + 1 < size && (size_type{1} << depth) < 16 * m_thread_count)
+      ++depth;
+    m_split(first, component, 0, depth);
+    for (size_type w = 1; w < m_workers.size(); ++w) {
+      auto& worker = m_workers[w];
+      worker.placed = first.placed;
+      worker.unassigned = first.unassigned;
+      m_reset(worker, size);
+    }
+    // Subtrees were added to the first worker and are dealt out in turns.
+    for (size_type t = 0; !first.tasks.empty(); ++t) {
+      auto task = std::move(first.tasks.back());
+      first.tasks.pop_back();
+      m_workers[t % m_workers.size()].tasks.emplace_front(std::move(task));
+    }
+
+    while (m_threads.size() + 1 < m_workers.size()) {
+      const auto w = m_threads.size() + 1;
+      m_threads.emplace_back([this, w, round = m_round] { m_help(w, round); });
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_component = &component;
+      m_busy = m_threads.size();
+      ++m_round;
+    }
+    m_cv.notify_all();
+    m_work(first, component);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_done_cv.wait(lock, [this] { return m_busy == 0; });
+    }
+
+    component.counts.assign(size + 1, 0.0);
+    component.mine_counts.assign(size + 1, {});
+    for (auto& worker : m_workers) {
+      for (size_type k = 0; k <= size; ++k) {
+        component.counts[k] += worker.counts[k];
+        if (worker.mine_counts[k].empty())
+          continue;
+        auto& mine_counts = component.mine_counts[k];
+        if (mine_counts.empty())
+          mine_counts.assign(size, 0.0);
+        for (size_type pos = 0; pos < size; ++pos)
+          mine_counts[pos] += worker.mine_counts[k][pos];
+      }
+    }
+  }
+
+  // @brief Adds assignments of the first %depth cells which fit the
+  // constraints as tasks of %worker.
+  void m_split(Worker& worker, const Component& component, size_type pos,
+               size_type depth) {
+    if (pos == depth) {
+      worker.tasks.emplace_back(worker.assignment.begin(),
+                           worker.assignment.begin() + depth);
+      return;
+    }
+    const auto cell = component.cells[pos];
+    for (int value = 0; value < 2; ++value) {
+      if (m_b_assign(worker, cell, value)) {
+        worker.assignment[pos] = value;
+        m_split(worker, component, pos + 1, depth);
+      }
+      m_unassign(worker, cell, value);
+    }
+  }
+
+  // @brief Runs worker %w on each component handed to the threads after
+  // round %round, until stopped.
+  void m_help(size_type w, size_type round) {
+    auto& worker = m_workers[w];
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_cv.wait(lock, [&] { return m_b_stopped || m_round != round; });
+      if (m_b_stopped)
+        return;
+      round = m_round;
+      lock.unlock();
+      m_work(worker, *m_component);
+      lock.lock();
+      if (--m_busy == 0)
+        m_done_cv.notify_one();
+    }
+  }
+
+  // @brief Stops and joins the threads.
+  void m_stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_b_stopped = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads)
+      thread.join();
+    m_threads.clear();
+    m_b_stopped = false;
+  }
+
+  // @brief Searches subtrees of %worker and those stolen from other workers
+  // until none are left.
+  void m_work(Worker& worker, const Component& component) {
+    std::vector<unsigned char> task;
+    while (m_b_take(worker, task)) {
+      size_type mines = 0;
+      for (size_type pos = 0; pos < task.size(); ++pos) {
+        m_b_assign(worker, component.cells[pos], task[pos]);
+        worker.assignment[pos] = task[pos];
+        mines += task[pos];
+      }
+      m_search(worker, component, task.size(), mines);
+      for (auto pos = task.size(); pos-- > 0;)
+        m_unassign(worker, component.cells[pos], task[pos]);
+    }
+    m_add_steps(worker);
+  }
+
+  // @brief Takes the latest subtree of %worker or steals the oldest one of
+  // another worker. Returns false if there are none left.
+  bool m_b_take(Worker& worker, std::vector<unsigned char>& task) {
+    {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if (!worker.tasks.empty()) {
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+      }
+    }
+    for (auto& victim : m_workers) {
+      if (&victim == &worker)
+        continue;
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void m_reset(Worker& worker, size_type size) {
+    worker.assignment.assign(size, 0);
+    worker.counts.assign(size + 1, 0.0);
+    worker.mine_counts.assign(size + 1, {});
+    worker.steps = 0;
+  }
+
+  // @brief Counts %steps taken by %worker. Returns false once the workers
+  // together have taken more than %MAX_STEPS steps or the deadline has
+  // passed, which is checked a batch of steps at a time.
+  bool m_b_step(Worker& worker, size_type steps = 1) {
+    worker.steps += steps;
+    if (worker.steps >= STEP_BATCH)
+      m_add_steps(worker);
+    return !m_b_given_up.load(std::memory_order_relaxed);
+  }
+
+  void m_add_steps(Worker& worker) {
+    if (m_steps.fetch_add(worker.steps, std::memory_order_relaxed) +
+            worker.steps >
+        MAX_STEPS || m_b_past_deadline())
+      m_b_given_up.store(true, std::memory_order_relaxed);
+    worker.steps = 0;
+  }
+
+  bool m_b_past_deadline() const {
+    return m_deadline != clock_type::time_point::max() &&
+           clock_type::now() >= m_deadline;
+  }
+
+  void m_search(Worker& worker, const Component& component, size_type pos,
+                size_type mines) {
+    if (!m_b_step(worker))
+      return;
+    if (pos == component.cells.size()) {
+      m_record(worker, mines);
+      return;
+    }
+    const auto cell = component.cells[pos];
+    for (int value = 0;
+         value < 2 && !m_b_given_up.load(std::memory_order_relaxed); ++value) {
+      if (m_b_assign(worker, cell, value)) {
+        worker.assignment[pos] = value;
+        m_search(worker, component, pos + 1, mines + value);
+      }
+      m_unassign(worker, cell, value);
+    }
+  }
+
+  // @brief Assigns %value to %cell. Returns false if some constraint of the
+  // cell can no longer be met. Assignment is undone with %m_unassign either
+  // way.
+  bool m_b_assign(Worker& worker, size_type cell, int value) {
+    const auto& frontier = *m_frontier;
+    const auto& mines = frontier.constraint_mines;
+    bool b_ok = true;
+    for (auto k = frontier.cell_offsets[cell];
+         k < frontier.cell_offsets[cell + 1]; ++k) {
+      const auto constraint = frontier.cell_constraints[k];
+      worker.placed[constraint] += value;
+      --worker.unassigned[constraint];
+      b_ok &= worker.placed[constraint] <= mines[constraint] &&
+              worker.placed[constraint] + worker.unassigned[constraint] >=
+                  mines[constraint];
+    }
+    return b_ok;
+  }
+
+  void m_unassign(Worker& worker, size_type cell, int value) {
+    const auto& frontier = *m_frontier;
+    for (auto k = frontier.cell_offsets[cell];
+         k < frontier.cell_offsets[cell + 1]; ++k) {
+      const auto constraint = frontier.cell_constraints[k];
+      worker.placed[constraint] -= value;
+      ++worker.unassigned[constraint];
+    }
+  }
+
+  void m_record(Worker& worker, size_type mines) {
+    const auto size = worker.assignment.size();
+    m_b_step(worker, size);
+    worker.counts[mines] += 1.0;
+    auto& mine_counts = worker.mine_counts[mines];
+    if (mine_counts.empty())
+      mine_counts.assign(size, 0.0);
+    for (size_type pos = 0; pos < size; ++pos)
+      mine_counts[pos] += worker.assignment[pos];
+  }
+
+  // @brief Returns amounts of mines %component can have on its own, a bit
+  // per amount.
+  static bits_type m_amounts(const Component& component) {
+    const auto size = component.cells.size();
+    bits_type amounts(size / 64 + 1, 0);
+    for (size_type k = 0; k <= size; ++k)
+      if (!component.b_complete || component.counts[k] > 0.0)
+        amounts[k / 64] |= std::uint64_t{1} << (k % 64);
+    return amounts;
+  }
+
+  static bool m_b_bit(const bits_type& bits, size_type k) noexcept {
+    return k / 64 < bits.size() && (bits[k / 64] >> (k % 64)) & 1;
+  }
+
+  // @brief Returns every sum of an amount in %sums and an amount in
+  // %amounts, limited to %size bits.
+  static bits_type m_add(const bits_type& sums, const bits_type& amounts,
+                         size_type size) {
+    bits_type result(size / 64 + 1, 0);
+    for (size_type w = 0; w < amounts.size(); ++w)
+      for (auto word = amounts[w]; word != 0; word &= word - 1) {
+        const auto shift = w * 64 + bit_scan(word);
+        const auto words = shift / 64, bits = shift % 64;
+        for (size_type i = 0; i < sums.size() && i + words < result.size();
+             ++i) {
+          result[i + words] |= sums[i] << bits;
+          if (bits != 0 && i + words + 1 < result.size())
+            result[i + words + 1] |= sums[i] >> (64 - bits);
+        }
+      }
+    return result;
+  }
+
+  // @brief Returns true if %sums has an amount in range [%low, %high].
+  static bool m_b_any(const bits_type& sums, std::int64_t low,
+                      std::int64_t high) noexcept {
+    high = std::min<std::int64_t>(high, sums.size() * 64 - 1);
+    for (auto k = std::max<std::int64_t>(low, 0); k <= high; ++k)
+      if (m_b_bit(sums, static_cast<size_type>(k)))
+        return true;
+    return false;
+  }
+
+  // @brief Scales %values so that the largest is one. Probabilities are
+  // ratios, so a common factor doesn't change them.
+  static void m_normalize(std::vector<double>& values) {
+    const auto largest = *std::max_element(values.begin(), values.end());
+    if (largest > 0.0)
+      for (auto& value : values)
+        value /= largest;
+  }
+
+  // @brief Stores the solution counts of components [%lo, %hi) together by
+  // their amount of mines to %product, up to a common factor.
+  void m_product(size_type lo, size_type hi, std::vector<double>& product) {
+    if (hi - lo == 0) {
+      product.assign(1, 1.0);
+      return;
+    }
+    if (hi - lo == 1) {
+      product = m_components[lo].counts;
+      m_normalize(product);
+      return;
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    std::vector<double> low, high;
+    m_product(lo, mid, low);
+    m_product(mid, hi, high);
+    product.assign(low.size() + high.size() - 1, 0.0);
+    for (size_type a = 0; a < low.size(); ++a)
+      if (low[a] > 0.0)
+        for (size_type b = 0; b < high.size(); ++b)
+          product[a + b] += low[a] * high[b];
+    m_normalize(product);
+  }
+
+  // @brief Stores to %m_weights the weight of each mine amount of each
+  // component in [%lo, %hi), given the weight of each total amount of these
+  // components in %weights. Components are halved recursively so that each
+  // half is weighted by the other's solutions, which takes quadratic time in
+  // the amount of cells instead of cubic.
+  void m_distribute(size_type lo, size_type hi,
+                    const std::vector<double>& weights) {
+    if (hi - lo == 0)
+      return;
+    if (hi - lo == 1) {
+      m_weights[lo] = weights;
+      return;
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    std::vector<double> other, half;
+    for (int b_low = 1; b_low >= 0; --b_low) {
+      if (b_low)
+        m_product(mid, hi, other);
+      else
+        m_product(lo, mid, other);
+      half.assign(weights.size() - other.size() + 1, 0.0);
+      for (size_type a = 0; a < half.size(); ++a)
+        for (size_type b = 0; b < other.size(); ++b)
+          half[a] += weights[a + b] * other[b];
+      m_normalize(half);
+      if (b_low)
+        m_distribute(lo, mid, half);
+      else
+        m_distribute(mid, hi, half);
+    }
+  }
+
+  // @brief Combines components under the total mine count and sets the
+  // verdicts. Returns false if no combination fits the mine count.
+  bool m_combine() {
+    const auto& frontier = *m_frontier;
+    const auto mines = static_cast<std::int64_t>(frontier.mines_left),
+               interior = static_cast<std::int64_t>(frontier.interior.size());
+    const auto count = m_components.size();
+    size_type total = 0;
+    std::int64_t min_sum = 0, max_sum = 0;
+    for (const auto& component : m_components) {
+      total += component.cells.size();
+      const auto amounts = m_amounts(component);
+      std::int64_t k = 0;
+      while (!m_b_bit(amounts, k))
+        ++k;
+      min_sum += k;
+      for (k = component.cells.size(); !m_b_bit(amounts, k); --k)
+        ;
+      max_sum += k;
+    }
+
+    // Interior holds the mines the frontier leaves over. When it can hold
+    // those of any combination, components don't limit each other.
+    const bool b_independent = min_sum >= mines - interior && max_sum <= mines;
+    std::vector<bits_type> prefix(count + 1), suffix(count + 1);
+    if (!b_independent) {
+      // Amounts of mines reachable by components [0, c) and [c, count).
+      prefix[0].assign(total / 64 + 1, 0);
+      prefix[0][0] = 1;
+      suffix[count] = prefix[0];
+      for (size_type c = 0; c < count; ++c)
+        prefix[c + 1] = m_add(prefix[c], m_amounts(m_components[c]), total);
+      for (auto c = count; c-- > 0;)
+        suffix[c] = m_add(suffix[c + 1], m_amounts(m_components[c]), total);
+      if (!m_b_any(prefix[count], mines - interior, mines))
+        return false;
+    }
+    if (interior > 0) {
+      const bool b_mine =
+          b_independent ? min_sum < mines
+                        : m_b_any(prefix[count], mines - interior, mines - 1);
+      const bool b_safe =
+          b_independent
+              ? max_sum > mines - interior
+              : m_b_any(prefix[count], mines - interior + 1, mines);
+      m_interior = b_mine ? (b_safe ? UNDECIDED : MINE) : SAFE;
+    }
+
+    for (size_type c = 0; c < count; ++c) {
+      const auto& component = m_components[c];
+      if (!component.b_complete)
+        continue;
+      bits_type others;
+      if (!b_independent)
+        others = m_add(prefix[c], suffix[c + 1], total);
+      const auto size = component.cells.size();
+      std::vector<unsigned char> b_mine(size, false), b_safe(size, false);
+      for (size_type k = 0; k <= size; ++k) {
+        const auto amount = static_cast<std::int64_t>(k);
+        if (component.counts[k] == 0.0 ||
+            (!b_independent &&
+             !m_b_any(others, mines - interior - amount, mines - amount)))
+          continue;
+        for (size_type pos = 0; pos < size; ++pos) {
+          b_mine[pos] |= component.mine_counts[k][pos] > 0.0;
+          b_safe[pos] |= component.mine_counts[k][pos] < component.counts[k];
+        }
+      }
+      for (size_type pos = 0; pos < size; ++pos)
+        if (b_mine[pos] != b_safe[pos])
+          m_verdicts[component.cells[pos]] = b_mine[pos] ? MINE : SAFE;
+    }
+    return true;
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -2,15 +2,19 @@
 #define GAMEMANAGER_HPP
 
 #include <algorithm>
+#include <chrono>
 #include <exception>
 #include <memory>
 
 #include "SDL2/SDL.h"
 
+#include "boardpool.hpp"
+#include "boardsearch.hpp"
 #include "boardtile.hpp"
 #include "mineboard.hpp"
 #include "mineboardsolver.hpp"
 #include "mineraker.hpp"
+#include "solverexecutor.hpp"
 #include "text.hpp"
 #include "texture.hpp"
 #include "windowmanager.hpp"
@@ -23,19 +27,37 @@ namespace rake {
  */
 class GameManager {
 public:
+  // Time to search for a solvable board before settling for the one which the
+  // solver got furthest on.
+  static constexpr std::chrono::milliseconds SOLVABLE_SEARCH_TIMEOUT{3000};
+  // Time to look for a hint. Hints are found in the background, so this only
+  // bounds how long the player waits for one.
+  static constexpr std::chrono::milliseconds HINT_BUDGET{100};
+
   explicit GameManager()
-      : m_window(nullptr), m_board(nullptr), m_tile_texture(nullptr) {}
+      : m_window(nullptr), m_board(nullptr), m_tile_texture(nullptr),
+        m_board_version(0), m_b_searching(false) {}
   explicit GameManager(WindowManager* windowmanager, MineBoard* mineboard,
-                       Texture* tile_texture) {
+                       Texture* tile_texture)
+      : m_board(nullptr), m_board_version(0), m_b_searching(false) {
     init(windowmanager, mineboard, tile_texture);
   }
-  ~GameManager() {}
+  ~GameManager() {
+    // Jobs are stopped first so no completion outlives the board.
+    m_executor.stop();
+    if (m_board != nullptr)
+      m_board->unsubscribe(m_observer_id);
+  }
 
   void init(WindowManager* windowmanager, MineBoard* mineboard,
             Texture* tile_texture) {
+    if (m_board != nullptr)
+      m_board->unsubscribe(m_observer_id);
     m_window = windowmanager;
     m_board = mineboard;
     m_tile_texture = tile_texture;
+    m_observer_id = m_board->subscribe(
+        [this](const MineBoard::Changes&) { ++m_board_version; });
 
     auto clip_width = m_tile_texture->width() / TEXTURE_WIDTH_COUNT,
          clip_height = m_tile_texture->height() / TEXTURE_HEIGHT_COUNT;
@@ -57,45 +79,107 @@ public:
 
   // Opens specified tile from mouse coordinates.
   void open_from(int mouse_x, int mouse_y) {
+    if (m_b_searching)
+      return;
     size_type idx = m_mouse_to_index(mouse_x, mouse_y);
-    bool was_first = m_board->state() == rake::MineBoard::State::FIRST_MOVE;
+    if (m_board->state() == rake::MineBoard::State::FIRST_MOVE) {
+      if (idx >= m_board->tile_count())
+        return;
+      prepare_boards();
+      if (m_pool.pop(idx, *m_board))
+        m_board->open_tile(idx);
+      else
+        find_solvable_game(idx);
+      return;
+    }
     m_board->open_tile(idx);
-    if (was_first)
-      find_solvable_game(idx);
+  }
+
+  // Starts generating solvable boards of the current board's configuration in
+  // the background so that the first move won't have to search for one.
+  void prepare_boards() {
+    m_pool.reserve(
+        {m_board->width(), m_board->height(), m_board->mine_count()});
   }
 
   // Flags specified tile from mouse coordinates.
   void flag_from(int mouse_x, int mouse_y) {
+    if (m_b_searching)
+      return;
     m_board->flag_tile(m_mouse_to_index(mouse_x, mouse_y));
   }
 
   // Open all tiles which can be determined by their neighbouring flagged tiles
-  // and their own value.
+  // and their own value. Done in the background and applied by
+  // %apply_solver_results unless the board has changed since.
   void open_by_flagged() {
-    MineBoardSolver mbs(*m_board);
-    while (mbs.open_by_flagged())
-      ;
+    if (m_b_searching)
+      return;
+    m_submit([](MineBoard&, MineBoardSolver& solver) {
+      while (solver.open_by_flagged())
+        ;
+    });
   }
 
+  // Prints a move for the board without making it. Found in the background
+  // and printed by %apply_solver_results unless the board has changed since.
+  void hint() {
+    if (m_b_searching)
+      return;
+    const auto version = m_board_version;
+    auto hint = std::make_shared<MineBoardSolver::Hint>();
+    m_executor.submit(
+        *m_board,
+        [hint](MineBoard&, MineBoardSolver& solver) {
+          *hint = solver.hint(HINT_BUDGET);
+        },
+        [this, hint, version](MineBoard&) {
+          if (version != m_board_version)
+            return;
+          std::cerr << "\nhint " << hint->kind << " at " << hint->idx
+                    << ", mine probability " << hint->probability;
+        });
+  }
+
+  // Makes the first move at %idx on a board which can be solved without
+  // guessing from there. Boards are searched in parallel in the background
+  // and if none is found in time, the one which the solver got furthest on is
+  // used. The board stays at its first move and moves are ignored until the
+  // search is done, and the move is dropped if the board has changed
+  // otherwise meanwhile.
   void find_solvable_game(size_type idx) {
-    MineBoardSolver mbs(*m_board);
-    size_type i = 0;
-    while (m_board->state() != rake::MineBoard::State::GAME_WIN) {
-      auto seed =
-          std::chrono::high_resolution_clock::now().time_since_epoch().count();
-      m_board->init(m_board->width(), m_board->height(), seed,
-                    m_board->mine_count());
-      m_board->open_tile(idx);
-      if (mbs.b_solve())
-        mbs.open_by_flagged();
-      ++i;
-    }
-    m_board->init(m_board->width(), m_board->height(), m_board->seed(),
-                  m_board->mine_count());
-    m_board->open_tile(idx);
-    std::cerr << "\niterations to find solvable: " << i;
+    const auto seed =
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    const auto version = m_board_version;
+    m_b_searching = true;
+    m_executor.submit(
+        *m_board,
+        [idx, seed](MineBoard& board, MineBoardSolver&) {
+          auto result = BoardSearch().find(board.width(), board.height(),
+                                           board.mine_count(), idx, seed,
+                                           SOLVABLE_SEARCH_TIMEOUT);
+          board.init(board.width(), board.height(), result.seed,
+                     board.mine_count(), result.board_index);
+          std::cerr << "\niterations to find solvable: " << result.attempts;
+          if (!result.b_solvable)
+            std::cerr << "\nNo solvable board found in time.";
+        },
+        [this, idx, version](MineBoard& result) {
+          m_b_searching = false;
+          if (version != m_board_version)
+            return;
+          // Board is started anew from the found one so that the new game
+          // reaches the board's replay log.
+          m_board->init(result.width(), result.height(), result.seed(),
+                        result.mine_count(), result.board_index());
+          m_board->open_tile(idx);
+        });
   }
 
+  // Applies the results of finished background solving to the board. Called
+  // once per frame, before rendering.
+  void apply_solver_results() { m_executor.complete(); }
+
   // Renders the board to the window.
   void render() const {
     if (m_window == nullptr || m_board == nullptr ||
@@ -112,6 +196,31 @@ public:
   }
 
 private:
+  // Runs %job on a copy of the board in the background. Moves of the job are
+  // made on the board if the board hasn't changed by the time they are
+  // applied.
+  void m_submit(SolverExecutor::job_type job) {
+    const auto version = m_board_version;
+    m_executor.submit(*m_board, std::move(job),
+                      [this, version](MineBoard& result) {
+                        if (version == m_board_version)
+                          m_apply_moves(result);
+                      });
+  }
+
+  // Brings the board to %result, which has the same mines, with the board's
+  // own moves instead of replacing it, so that the moves reach its replay
+  // log. Differing flags are toggled and the tiles open in %result are
+  // opened, skipping those already opened by an earlier move.
+  void m_apply_moves(const MineBoard& result) {
+    for (size_type i = 0; i < result.tile_count(); ++i)
+      if (m_board->m_tiles[i].is_flagged() != result.m_tiles[i].is_flagged())
+        m_board->flag_tile(i);
+    for (size_type i = 0; i < result.tile_count(); ++i)
+      if (result.m_tiles[i].is_open() && !m_board->m_tiles[i].is_open())
+        m_board->open_tile(i);
+  }
+
   SDL_Rect texture_clip_tile(const BoardTile& tile) const {
     SDL_Rect clip;
     if (tile.is_open())
@@ -158,6 +267,16 @@ private:
   WindowManager* m_window;
   MineBoard* m_board;
   Texture* m_tile_texture;
+  // Ready solvable boards for first moves.
+  BoardPool m_pool;
+  // Solving kept off the frame loop.
+  SolverExecutor m_executor;
+  // Changes of the board seen, which tell results of solving started from
+  // an older board apart.
+  size_type m_board_version;
+  size_type m_observer_id;
+  // Set while a solvable board is searched for the first move.
+  bool m_b_searching;
 
   // Array to store texture clipping coordinates.
   std::array<SDL_Rect, TEXTURE_WIDTH_COUNT * TEXTURE_HEIGHT_COUNT>
@@ -41,6 +41,7 @@ int main(int argc, char* argv[]) {
   rake::GameManager gm{&wm, &mb, &tx};
 
   mb.init(30, 16, time(0), 99);
+  gm.prepare_boards();
 
   SDL_GetWindowDisplayMode(wm, &display_mode);
   int refresh_rate = std::max(display_mode.refresh_rate, 60);
@@ -66,6 +67,8 @@ int main(int argc, char* argv[]) {
       } else if (event.type == SDL_KEYDOWN) {
         if (event.key.keysym.sym == SDLK_SPACE)
           gm.open_by_flagged();
+        else if (event.key.keysym.sym == SDLK_h)
+          gm.hint();
       }
       wm.handle_event(&event);
 
@@ -84,6 +87,7 @@ int main(int argc, char* argv[]) {
     std::this_thread::sleep_for(sleep_time);
     frame_time = std::chrono::steady_clock::now().time_since_epoch();
 
+    gm.apply_solver_results();
     SDL_RenderClear(wm);
     gm.render();
     SDL_RenderPresent(wm);
@@ -2,18 +2,21 @@
 #define MINEBOARD_HPP
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <optional>
-#include <random>
-#include <stack>
 #include <utility>
 #include <vector>
 
 #include "boardtile.hpp"
 #include "mineraker.hpp"
+#include "numberkernel.hpp"
+#include "philox.hpp"
+#include "replaylog.hpp"
 
 namespace rake {
 
@@ -32,6 +35,7 @@ class MineBoard {
 public:
   using tile_type = BoardTile;
   using this_type = MineBoard;
+  using seed_type = std::uint64_t;
 
   struct pos_type {
     diff_type x, y;
@@ -118,28 +122,165 @@ public:
 
   static const unsigned char TILE_NEIGHBOUR_COUNT = 8;
 
+  // Tiles changed by a single operation on the board.
+  struct Changes {
+    const size_type* tiles;
+    size_type count;
+    // True when any tile may have changed, as when the board is initialized
+    // or its mines are laid. %tiles is empty then.
+    bool b_all;
+
+    const size_type* begin() const noexcept { return tiles; }
+    const size_type* end() const noexcept { return tiles + count; }
+  };
+  using observer_type = std::function<void(const Changes&)>;
+  // Region label of tiles not belonging to any opening region.
+  static constexpr std::uint32_t NO_REGION =
+      std::numeric_limits<std::uint32_t>::max();
+
+  /**
+   * @brief Range of tile's neighbour indexes inside the board bounds. Walks
+   * the tile's neighbour mask so no memory is allocated. Indexes are
+   * iterated in ascending order.
+   */
+  class neighbour_range {
+  public:
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = size_type;
+      using difference_type = diff_type;
+      using pointer = const size_type*;
+      using reference = size_type;
+
+      constexpr iterator(size_type idx, unsigned mask,
+                         const diff_type* offsets) noexcept
+          : m_idx(idx), m_mask(mask), m_offsets(offsets) {}
+
+      size_type operator*() const noexcept {
+        return m_idx + m_offsets[bit_scan(m_mask)];
+      }
+
+      iterator& operator++() noexcept {
+        m_mask &= m_mask - 1;
+        return *this;
+      }
+
+      iterator operator++(int) noexcept {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+      }
+
+      constexpr bool operator==(const iterator& other) const noexcept {
+        return m_mask == other.m_mask;
+      }
+
+      constexpr bool operator!=(const iterator& other) const noexcept {
+        return m_mask != other.m_mask;
+      }
+
+    private:
+      size_type m_idx;
+      unsigned m_mask;
+      const diff_type* m_offsets;
+    };
+
+    constexpr neighbour_range(size_type idx, unsigned mask,
+                              const diff_type* offsets) noexcept
+        : m_idx(idx), m_mask(mask), m_offsets(offsets) {}
+
+    constexpr iterator begin() const noexcept {
+      return {m_idx, m_mask, m_offsets};
+    }
+    constexpr iterator end() const noexcept { return {m_idx, 0, m_offsets}; }
+    // @brief Returns the amount of neighbours in the range.
+    size_type size() const noexcept { return bit_count(m_mask); }
+
+  private:
+    size_type m_idx;
+    unsigned m_mask;
+    const diff_type* m_offsets;
+  };
+
 private:
 public:
   // Default container for the board tiles.
   std::vector<tile_type> m_tiles;
-  // Vector to store already opened empty tiles. Speeds up empty area opening
-  // operations dramatically.
-  std::vector<bool> m_opened_empty_tiles;
   // Variable for storing the board width.
   size_type m_width;
   // Variable for storing the board height.
   size_type m_height;
   // Seed for mined tile position randomization.
-  std::mt19937_64::result_type m_seed;
+  seed_type m_seed;
   // Stores the amount of mines on the board.
   size_type m_mine_count;
   // Represents current state of the board.
   State m_state;
+  // Running count of opened tiles.
+  size_type m_open_count;
+  // Running count of flagged tiles.
+  size_type m_flag_count;
+  // Running count of tiles without a mine which are still closed. Game is won
+  // when this reaches zero.
+  size_type m_safe_left;
+  // Stores the amount of flagged neighbours for each tile. Kept up to date by
+  // %m_set_flag.
+  std::vector<unsigned char> m_flagged_neighbours;
+  // Bit mask of in-bounds neighbour directions for each tile. Bits follow the
+  // order of %m_neighbour_offsets. Rebuilt when board dimensions change.
+  std::vector<unsigned char> m_neighbour_masks;
+  // Index offsets to neighbours in ascending order: up-left, up, up-right,
+  // left, right, down-left, down and down-right.
+  std::array<diff_type, TILE_NEIGHBOUR_COUNT> m_neighbour_offsets;
+  // Flood epoch of the last visit for each tile. Tile is visited by the
+  // current flood when its stamp equals %m_flood_epoch, so the stamps don't
+  // have to be cleared between floods.
+  std::vector<std::uint32_t> m_flood_stamps;
+  // Epoch of the latest flood.
+  std::uint32_t m_flood_epoch;
+  // Reusable stack of span seeds for flood opening.
+  std::vector<size_type> m_flood_seeds;
+  // Reusable padded mine plane and mine counts for numbering tiles.
+  std::vector<unsigned char> m_number_plane, m_number_counts;
+  // Defines if opening regions are labelled when mines are laid.
+  bool m_b_label_regions;
+  // Opening region label of each empty tile. Other tiles have %NO_REGION.
+  std::vector<std::uint32_t> m_region_of;
+  // Region r's tiles are stored in %m_region_tiles at range
+  // [m_region_offsets[r], m_region_offsets[r + 1]). Empty when regions
+  // aren't labelled.
+  std::vector<std::uint32_t> m_region_offsets;
+  // Tiles of each opening region: its empty tiles and their numbered border.
+  std::vector<std::uint32_t> m_region_tiles;
+  // Amount of flagged empty tiles in each region. Flags block the cascade so
+  // region with flags is opened by flood fill instead.
+  std::vector<std::uint32_t> m_region_flags;
+  // Minimum amount of clicks needed to clear the board, also known as 3BV.
+  // Calculated when regions are labelled.
+  size_type m_bbbv;
+  // Index of the board in the series of boards generated from %m_seed. Each
+  // index has its own random stream.
+  seed_type m_board_index;
+  // Log receiving games and actions of the board, if any. Not copied, as a
+  // copy would mix its actions into the same log.
+  ReplayLog* m_replay_log;
+  // Observers of changed tiles with their ids. Not copied, like the log.
+  std::vector<std::pair<size_type, observer_type>> m_observers;
+  size_type m_next_observer_id;
+  // Tiles changed since the observers were last notified. Only gathered
+  // while the board is observed.
+  std::vector<size_type> m_changes;
+  // Marks tiles already in %m_changes.
+  std::vector<unsigned char> m_b_changed;
+  bool m_b_all_changed;
 
   // Adds control for the Control class. Might not be final.
   friend class GameManager;
   // Allows formatter to access private methods and variables.
   friend class MineBoardFormat;
+  // Allows bit plane backend to convert from and to board tiles.
+  friend class BitBoard;
   // Allows solver to access private information needed for solving the board.
   friend class MineBoardSolver;
 
@@ -147,51 +288,122 @@ public:
   // @brief Default constructor without parameters.
   MineBoard()
       : m_width(0), m_height(0), m_seed(0), m_mine_count(0),
-        m_state(UNINITIALIZED) {}
+        m_state(UNINITIALIZED), m_open_count(0), m_flag_count(0),
+        m_safe_left(0), m_neighbour_offsets(), m_flood_epoch(0),
+        m_b_label_regions(false), m_bbbv(0), m_board_index(0),
+        m_replay_log(nullptr), m_next_observer_id(0), m_b_all_changed(false) {}
   MineBoard(const this_type& other)
       : m_tiles(other.m_tiles),
-        m_opened_empty_tiles(other.m_opened_empty_tiles),
         m_width(other.m_width), m_height(other.m_height), m_seed(other.m_seed),
-        m_mine_count(other.m_mine_count), m_state(other.m_state) {}
+        m_mine_count(other.m_mine_count), m_state(other.m_state),
+        m_open_count(other.m_open_count), m_flag_count(other.m_flag_count),
+        m_safe_left(other.m_safe_left),
+        m_flagged_neighbours(other.m_flagged_neighbours),
+        m_neighbour_masks(other.m_neighbour_masks),
+        m_neighbour_offsets(other.m_neighbour_offsets),
+        m_flood_stamps(other.m_flood_stamps),
+        m_flood_epoch(other.m_flood_epoch),
+        m_b_label_regions(other.m_b_label_regions),
+        m_region_of(other.m_region_of),
+        m_region_offsets(other.m_region_offsets),
+        m_region_tiles(other.m_region_tiles),
+        m_region_flags(other.m_region_flags),
+        m_bbbv(other.m_bbbv),
+        m_board_index(other.m_board_index), m_replay_log(nullptr),
+        m_next_observer_id(0), m_b_all_changed(false) {}
   MineBoard(this_type&& other) noexcept
       : m_tiles(std::move(other.m_tiles)),
-        m_opened_empty_tiles(std::move(other.m_opened_empty_tiles)),
         m_width(std::move(other.m_width)), m_height(std::move(other.m_height)),
         m_seed(std::move(other.m_seed)),
         m_mine_count(std::move(other.m_mine_count)),
-        m_state(std::move(other.m_state)) {}
+        m_state(std::move(other.m_state)),
+        m_open_count(std::move(other.m_open_count)),
+        m_flag_count(std::move(other.m_flag_count)),
+        m_safe_left(std::move(other.m_safe_left)),
+        m_flagged_neighbours(std::move(other.m_flagged_neighbours)),
+        m_neighbour_masks(std::move(other.m_neighbour_masks)),
+        m_neighbour_offsets(std::move(other.m_neighbour_offsets)),
+        m_flood_stamps(std::move(other.m_flood_stamps)),
+        m_flood_epoch(std::move(other.m_flood_epoch)),
+        m_b_label_regions(std::move(other.m_b_label_regions)),
+        m_region_of(std::move(other.m_region_of)),
+        m_region_offsets(std::move(other.m_region_offsets)),
+        m_region_tiles(std::move(other.m_region_tiles)),
+        m_region_flags(std::move(other.m_region_flags)),
+        m_bbbv(std::move(other.m_bbbv)),
+        m_board_index(std::move(other.m_board_index)),
+        m_replay_log(nullptr), m_next_observer_id(0), m_b_all_changed(false) {}
   ~MineBoard() noexcept {}
 
   this_type& operator=(const this_type& other) {
     m_tiles = other.m_tiles;
-    m_opened_empty_tiles = other.m_opened_empty_tiles;
     m_width = other.m_width;
     m_height = other.m_height;
     m_seed = other.m_seed;
     m_mine_count = other.m_mine_count;
+    m_state = other.m_state;
+    m_open_count = other.m_open_count;
+    m_flag_count = other.m_flag_count;
+    m_safe_left = other.m_safe_left;
+    m_flagged_neighbours = other.m_flagged_neighbours;
+    m_neighbour_masks = other.m_neighbour_masks;
+    m_neighbour_offsets = other.m_neighbour_offsets;
+    m_flood_stamps = other.m_flood_stamps;
+    m_flood_epoch = other.m_flood_epoch;
+    m_b_label_regions = other.m_b_label_regions;
+    m_region_of = other.m_region_of;
+    m_region_offsets = other.m_region_offsets;
+    m_region_tiles = other.m_region_tiles;
+    m_region_flags = other.m_region_flags;
+    m_bbbv = other.m_bbbv;
+    m_board_index = other.m_board_index;
+    m_note_all_changed();
+    m_notify_observers();
 
     return *this;
   }
 
   this_type&& operator=(this_type&& other) noexcept {
     m_tiles = std::move(other.m_tiles);
-    m_opened_empty_tiles = std::move(other.m_opened_empty_tiles);
     m_width = std::move(other.m_width);
     m_height = std::move(other.m_height);
     m_seed = std::move(other.m_seed);
     m_mine_count = std::move(other.m_mine_count);
+    m_state = std::move(other.m_state);
+    m_open_count = std::move(other.m_open_count);
+    m_flag_count = std::move(other.m_flag_count);
+    m_safe_left = std::move(other.m_safe_left);
+    m_flagged_neighbours = std::move(other.m_flagged_neighbours);
+    m_neighbour_masks = std::move(other.m_neighbour_masks);
+    m_neighbour_offsets = std::move(other.m_neighbour_offsets);
+    m_flood_stamps = std::move(other.m_flood_stamps);
+    m_flood_epoch = std::move(other.m_flood_epoch);
+    m_b_label_regions = std::move(other.m_b_label_regions);
+    m_region_of = std::move(other.m_region_of);
+    m_region_offsets = std::move(other.m_region_offsets);
+    m_region_tiles = std::move(other.m_region_tiles);
+    m_region_flags = std::move(other.m_region_flags);
+    m_bbbv = std::move(other.m_bbbv);
+    m_board_index = std::move(other.m_board_index);
+    m_note_all_changed();
+    m_notify_observers();
 
     return std::move(*this);
   }
 
   void init(size_type width, size_type height,
-            std::mt19937_64::result_type seed, size_type mine_count) {
+            seed_type seed, size_type mine_count, seed_type board_index = 0) {
     resize(width, height);
     m_clear();
-    m_opened_empty_tiles = std::vector<bool>(tile_count(), false);
     m_seed = seed;
+    m_board_index = board_index;
     m_mine_count = mine_count;
+    m_safe_left = tile_count() - std::min(mine_count, tile_count());
     m_state = FIRST_MOVE;
+    if (m_replay_log != nullptr)
+      m_replay_log->board(width, height, mine_count, seed, board_index);
+    m_note_all_changed();
+    m_notify_observers();
   }
 
   State open_tile(size_type idx) {
@@ -210,43 +422,119 @@ public:
     default:
       break;
     }
+    m_notify_observers();
     return m_state;
   }
 
+  // @brief Opens tile %idx, or chords it if it is open. Moves are logged here
+  // and in %m_set_flag, which solvers call too, so that their moves reach
+  // the replay log as well. Games already over take no moves.
   void m_on_next_move(size_type idx) {
+    if (m_state != NEXT_MOVE)
+      return;
+    if (m_replay_log != nullptr)
+      m_replay_log->action(
+          m_tiles[idx].is_open() ? ReplayLog::CHORD : ReplayLog::OPEN, idx);
     m_flood_open(idx);
-    if (tile_count() - m_mine_count == open_tiles_count())
+    if (m_safe_left == 0 && m_state != GAME_LOSE)
       m_state = GAME_WIN;
   }
 
   void m_on_first_move(size_type idx) {
     m_set_mines(m_mine_count, idx);
+    // Layout goes first so that a replay lays the mines before opening
+    // instead of generating them.
+    if (m_replay_log != nullptr) {
+      m_replay_log->layout(m_tiles.data(), tile_count());
+      m_replay_log->action(ReplayLog::OPEN, idx);
+    }
+    m_note_all_changed();
+    m_safe_left = tile_count() - m_mine_count;
     m_set_numbered_tiles();
+    if (m_b_label_regions)
+      m_label_regions();
     m_flood_open(idx);
     m_state = NEXT_MOVE;
   }
 
+  // @brief Lays mines of %mines, which has a flag for every tile, on a board
+  // waiting for its first move instead of generating them. The first opened
+  // tile is then handled as any other move, so it should be a safe one.
+  void lay_mines(const std::vector<bool>& mines) {
+    if (m_state != FIRST_MOVE || mines.size() != tile_count())
+      return;
+    m_mine_count = 0;
+    for (size_type i = 0; i < tile_count(); ++i)
+      if (mines[i]) {
+        m_tiles[i].set_mine();
+        ++m_mine_count;
+      }
+    if (m_replay_log != nullptr)
+      m_replay_log->layout(m_tiles.data(), tile_count());
+    m_safe_left = tile_count() - m_mine_count;
+    m_set_numbered_tiles();
+    if (m_b_label_regions)
+      m_label_regions();
+    m_state = NEXT_MOVE;
+    m_note_all_changed();
+    m_notify_observers();
+  }
+
+  // @brief Toggles flag of the tile. Open tiles won't be flagged.
   void flag_tile(size_type idx) {
-    if (m_b_inside_bounds(idx))
-      m_tiles[idx].toggle_flag();
+    if (!m_b_inside_bounds(idx))
+      return;
+    m_set_flag(idx, !m_tiles[idx].is_flagged());
+    m_notify_observers();
+  }
+
+  // @brief Adds %observer to be called with the tiles changed by each
+  // operation on the board: opening or flagging tiles, initializing the board
+  // or laying its mines. Returns an id for %unsubscribe. Changes are gathered
+  // only while the board has observers.
+  size_type subscribe(observer_type observer) {
+    m_observers.emplace_back(m_next_observer_id, std::move(observer));
+    return m_next_observer_id++;
+  }
+
+  // @brief Removes observer with %id.
+  void unsubscribe(size_type id) {
+    m_observers.erase(
+        std::remove_if(m_observers.begin(), m_observers.end(),
+                       [id](const auto& entry) { return entry.first == id; }),
+        m_observers.end());
+    if (m_observers.empty())
+      m_clear_changes();
   }
 
+  // @brief Starts logging games and actions of the board to %log. Null stops
+  // logging.
+  void record(ReplayLog* log) noexcept { m_replay_log = log; }
+
+  // @brief Returns the log the board records to or null.
+  ReplayLog* recording() const noexcept { return m_replay_log; }
+
   void reset() { m_state = UNINITIALIZED; }
 
   // @brief Sets board dimensions and resizes the container.
   void resize(size_type width, size_type height) {
     try {
       m_tiles.resize(width * height);
-      m_opened_empty_tiles.resize(width * height);
-      m_width = width;
-      m_height = height;
+      m_flood_stamps.resize(width * height);
+      m_flagged_neighbours.resize(width * height);
+      if (width != m_width || height != m_height ||
+          m_neighbour_masks.size() != width * height) {
+        m_width = width;
+        m_height = height;
+        m_build_neighbour_masks();
+      }
     } catch (std::exception& e) {
       std::cerr << "\nError: Couldn't reserve memory for mineboard: "
                 << e.what();
     }
   }
 
-  auto seed(std::mt19937_64::result_type seed) noexcept {
+  auto seed(seed_type seed) noexcept {
     auto old = m_seed;
     m_seed = seed;
     return old;
@@ -254,6 +542,14 @@ public:
 
   constexpr auto seed() const noexcept { return m_seed; }
 
+  auto board_index(seed_type board_index) noexcept {
+    auto old = m_board_index;
+    m_board_index = board_index;
+    return old;
+  }
+
+  constexpr auto board_index() const noexcept { return m_board_index; }
+
   constexpr size_type state() const noexcept { return m_state; }
 
   // @brief Returns the width of the board.
@@ -269,21 +565,54 @@ public:
   constexpr size_type tile_count() const noexcept { return m_width * m_height; }
 
   // @brief Retunrs the amount of opened tiles on the board.
-  size_type open_tiles_count() const noexcept {
-    size_type open_tiles = 0;
-    for (const auto& tile : m_tiles)
-      if (tile.is_open())
-        ++open_tiles;
-    return open_tiles;
-  }
+  constexpr size_type open_tiles_count() const noexcept { return m_open_count; }
 
   // @brief Retunrs the amount of flagged tiles on the board.
-  size_type flagged_tiles_count() const noexcept {
-    size_type flagged_tiles = 0;
-    for (const auto& tile : m_tiles)
-      if (tile.is_flagged())
-        ++flagged_tiles;
-    return flagged_tiles;
+  constexpr size_type flagged_tiles_count() const noexcept {
+    return m_flag_count;
+  }
+
+  // @brief Returns the amount of closed tiles without a mine.
+  constexpr size_type safe_tiles_left() const noexcept { return m_safe_left; }
+
+  // @brief Sets whether opening regions are labelled when mines are laid.
+  // Labelled regions open without searching and give %openings_count and
+  // %bbbv.
+  void label_regions(bool b_label) noexcept { m_b_label_regions = b_label; }
+
+  // @brief Returns true if opening regions are labelled when mines are laid.
+  constexpr bool label_regions() const noexcept { return m_b_label_regions; }
+
+  // @brief Returns true if opening regions of the current board are labelled.
+  bool b_regions_labelled() const noexcept { return !m_region_offsets.empty(); }
+
+  // @brief Returns the amount of openings, connected areas of empty tiles, on
+  // the board. Requires labelled regions.
+  size_type openings_count() const noexcept {
+    return b_regions_labelled() ? m_region_offsets.size() - 1 : 0;
+  }
+
+  // @brief Returns the amount of tiles opened by clicking empty tile %idx.
+  // Returns 0 for tiles not empty. Requires labelled regions.
+  size_type opening_size(size_type idx) const noexcept {
+    if (!b_regions_labelled() || m_region_of[idx] == NO_REGION)
+      return 0;
+    return m_region_offsets[m_region_of[idx] + 1] -
+           m_region_offsets[m_region_of[idx]];
+  }
+
+  // @brief Returns the minimum amount of clicks needed to clear the board
+  // (3BV). Requires labelled regions.
+  constexpr size_type bbbv() const noexcept { return m_bbbv; }
+
+  // @brief Returns range over tile's neighbours inside the board bounds.
+  neighbour_range neighbours(size_type idx) const noexcept {
+    return {idx, m_neighbour_masks[idx], m_neighbour_offsets.data()};
+  }
+
+  // @brief Returns the amount of flagged neighbours of the tile.
+  size_type flagged_neighbours_count(size_type idx) const noexcept {
+    return m_flagged_neighbours[idx];
   }
 
   // @brief Returns the amount of neighbours tiles have combined.
@@ -334,71 +663,251 @@ public:
   void m_clear() {
     for (auto& tile : m_tiles)
       tile.clear();
-    std::fill(m_opened_empty_tiles.begin(), m_opened_empty_tiles.end(), false);
+    std::fill(m_flagged_neighbours.begin(), m_flagged_neighbours.end(), 0);
+    m_open_count = 0;
+    m_flag_count = 0;
+    m_region_offsets.clear();
+    m_bbbv = 0;
+  }
+
+  // @brief Adds tile to the changes observers are notified of.
+  void m_note_changed(size_type idx) {
+    if (m_observers.empty() || m_b_all_changed)
+      return;
+    if (m_b_changed.size() != tile_count())
+      m_b_changed.assign(tile_count(), false);
+    if (!m_b_changed[idx]) {
+      m_b_changed[idx] = true;
+      m_changes.emplace_back(idx);
+    }
+  }
+
+  // @brief Marks every tile changed. Single tiles are no longer gathered
+  // until observers have been notified.
+  void m_note_all_changed() {
+    if (m_observers.empty())
+      return;
+    m_clear_changes();
+    m_b_all_changed = true;
+  }
+
+  // @brief Notifies observers of the changes gathered since the previous
+  // notification, if there are any.
+  void m_notify_observers() {
+    if (m_observers.empty() || (m_changes.empty() && !m_b_all_changed))
+      return;
+    const Changes changes{m_changes.data(), m_changes.size(), m_b_all_changed};
+    for (auto& observer : m_observers)
+      observer.second(changes);
+    m_clear_changes();
+  }
+
+  void m_clear_changes() {
+    for (auto idx : m_changes)
+      m_b_changed[idx] = false;
+    m_changes.clear();
+    m_b_all_changed = false;
+  }
+
+  // @brief Recalculates running counters from the tiles. Needed only after
+  // tiles have been written directly instead of through member functions.
+  void m_recount() {
+    m_open_count = 0;
+    m_flag_count = 0;
+    m_safe_left = 0;
+    std::fill(m_flagged_neighbours.begin(), m_flagged_neighbours.end(), 0);
+    for (size_type i = 0; i < tile_count(); ++i) {
+      const auto& tile = m_tiles[i];
+      m_open_count += tile.is_open();
+      m_safe_left += !(tile.is_open() || tile.is_mine());
+      if (tile.is_flagged()) {
+        ++m_flag_count;
+        for (auto n : neighbours(i))
+          ++m_flagged_neighbours[n];
+      }
+    }
+  }
+
+  // @brief Sets or removes flag on the tile and updates flag counters. Open
+  // tiles won't be flagged. Changed flags are logged as toggles.
+  void m_set_flag(size_type idx, bool flagged) {
+    auto& tile = m_tiles[idx];
+    if (tile.is_flagged() == flagged || (flagged && tile.is_open()))
+      return;
+    if (m_replay_log != nullptr)
+      m_replay_log->action(ReplayLog::FLAG, idx);
+    m_note_changed(idx);
+    if (flagged) {
+      tile.set_flagged_unguarded();
+      ++m_flag_count;
+    } else {
+      tile.set_unflagged();
+      --m_flag_count;
+    }
+    for (auto n : neighbours(idx))
+      m_flagged_neighbours[n] += flagged ? 1 : -1;
+    if (b_regions_labelled() && m_region_of[idx] != NO_REGION)
+      m_region_flags[m_region_of[idx]] += flagged ? 1 : -1;
+  }
+
+  // @brief Labels connected empty areas with union-find and stores every
+  // area with its numbered border as an opening region. Also calculates 3BV
+  // of the board.
+  void m_label_regions() {
+    const auto count = tile_count();
+    auto is_empty = [this](size_type i) { return m_tiles[i].is_empty(); };
+    // Neighbour directions already visited when iterating in ascending order:
+    // up-left, up, up-right and left.
+    constexpr unsigned char PREVIOUS = 0b00001111;
+
+    // Union-find with roots linked to the smaller index so that the root is
+    // the first tile of its area.
+    m_region_of.resize(count);
+    auto find = [this](std::uint32_t i) {
+      while (m_region_of[i] != i)
+        i = m_region_of[i] = m_region_of[m_region_of[i]];
+      return i;
+    };
+    for (size_type i = 0; i < count; ++i) {
+      m_region_of[i] = static_cast<std::uint32_t>(i);
+      if (!is_empty(i))
+        continue;
+      for (auto n : neighbour_range(i, m_neighbour_masks[i] & PREVIOUS,
+                                    m_neighbour_offsets.data())) {
+        if (!is_empty(n))
+          continue;
+        auto a = find(static_cast<std::uint32_t>(i)),
+             b = find(static_cast<std::uint32_t>(n));
+        m_region_of[std::max(a, b)] = std::min(a, b);
+      }
+    }
+
+    // Point every tile straight to its root, then replace roots with dense
+    // labels. Roots come before their members.
+    for (size_type i = 0; i < count; ++i)
+      m_region_of[i] = find(static_cast<std::uint32_t>(i));
+    std::uint32_t regions = 0;
+    for (size_type i = 0; i < count; ++i) {
+      if (!is_empty(i))
+        m_region_of[i] = NO_REGION;
+      else if (m_region_of[i] == i)
+        m_region_of[i] = regions++;
+      else
+        m_region_of[i] = m_region_of[m_region_of[i]];
+    }
+
+    // Collects distinct regions touching tile %i into %labels.
+    auto touching = [this](size_type i, std::array<std::uint32_t, 9>& labels) {
+      size_type size = 0;
+      auto add = [&](std::uint32_t label) {
+        if (label != NO_REGION &&
+            std::find(labels.begin(), labels.begin() + size, label) ==
+                labels.begin() + size)
+          labels[size++] = label;
+      };
+      add(m_region_of[i]);
+      for (auto n : neighbours(i))
+        add(m_region_of[n]);
+      return size;
+    };
+
+    // Count region sizes, then fill tiles to their ranges.
+    std::array<std::uint32_t, 9> labels;
+    m_region_offsets.assign(regions + 1, 0);
+    m_bbbv = regions;
+    for (size_type i = 0; i < count; ++i) {
+      if (m_tiles[i].is_mine())
+        continue;
+      auto size = touching(i, labels);
+      if (size == 0)
+        ++m_bbbv;
+      for (size_type l = 0; l < size; ++l)
+        ++m_region_offsets[labels[l] + 1];
+    }
+    for (size_type r = 0; r < regions; ++r)
+      m_region_offsets[r + 1] += m_region_offsets[r];
+    m_region_tiles.resize(m_region_offsets.back());
+    m_region_flags.assign(regions, 0);
+    std::vector<std::uint32_t> cursors(m_region_offsets.begin(),
+                                       m_region_offsets.end() - 1);
+    for (size_type i = 0; i < count; ++i) {
+      if (m_tiles[i].is_mine())
+        continue;
+      auto size = touching(i, labels);
+      for (size_type l = 0; l < size; ++l)
+        m_region_tiles[cursors[labels[l]]++] = static_cast<std::uint32_t>(i);
+      if (m_tiles[i].is_flagged() && m_region_of[i] != NO_REGION)
+        ++m_region_flags[m_region_of[i]];
+    }
   }
 
   // @brief Calculates mine count from given count and distributes them
-  // evenly. %start_idx points to tile which won't filled by a mine.
+  // evenly. %start_idx points to tile which won't filled by a mine, neither
+  // will its neighbours.
   // @note Before calling, board must be empty of mines. Otherwise mine count
   // cannot be guaranteed.
   void m_set_mines(size_type mine_count, size_type start_idx) {
+    // Starting area is given by the neighbour mask of %start_idx. Its tiles
+    // in ascending order are skipped when mapping allowed cells to tiles.
+    std::array<size_type, TILE_NEIGHBOUR_COUNT + 1> start_area;
+    size_type start_size = 0;
+    bool b_start_added = false;
+    for (auto n : neighbours(start_idx)) {
+      if (!b_start_added && n > start_idx) {
+        start_area[start_size++] = start_idx;
+        b_start_added = true;
+      }
+      start_area[start_size++] = n;
+    }
+    if (!b_start_added)
+      start_area[start_size++] = start_idx;
+    auto to_tile = [&](size_type cell) {
+      for (size_type i = 0; i < start_size && start_area[i] <= cell; ++i)
+        ++cell;
+      return cell;
+    };
+
     // Make sure that mine count doesn't exceed board limits nor affect starting
     // area.
-    m_mine_count =
-        std::min(mine_count, tile_count() - m_neighbour_count(start_idx) - 1);
-
-    // Random number generator for random mine positions.
-    std::mt19937_64 rng(m_seed + m_width + m_height);
-
-    // Vector of tiles that won't be filled with mines.
-    auto empty_tiles = m_tile_neighbours_bnds(start_idx);
-    empty_tiles.emplace_back(start_idx);
-
-    // Loop until mines have been laid on the board.
-    for (size_type i = 0; i < m_mine_count; ++i) {
-      // Random index for placing a mine.
-      auto idx = rng() % tile_count();
-      if (!m_tiles[idx].is_mine()) {
-        bool set_mine = true;
-        // Ensure that %idx isn't one of the tiles not to be filled.
-        for (auto empty_idx : empty_tiles) {
-          if (idx == empty_idx) {
-            set_mine = false;
-            --i;
-          }
-        }
-        if (set_mine)
-          m_tiles[idx].set_mine();
-      }
-      // Reduce %i because the amount of mines haven't changed.
+    const auto allowed = tile_count() - start_size;
+    m_mine_count = std::min(mine_count, allowed);
+
+    // Counter-based generator gives every (seed, board index) pair its own
+    // stream, so any board of a series can be generated independently.
+    Philox4x32 rng(m_seed, m_board_index);
+
+    // Floyd's sampling picks exactly %m_mine_count distinct cells out of
+    // %allowed ones with one draw per mine whatever the density. Board tiles
+    // work as the set of already picked cells.
+    for (auto j = allowed - m_mine_count; j < allowed; ++j) {
+      auto cell = static_cast<size_type>(rng.below(j + 1));
+      auto& tile = m_tiles[to_tile(cell)];
+      if (tile.is_mine())
+        m_tiles[to_tile(j)].set_mine();
       else
-        --i;
+        tile.set_mine();
     }
   }
 
   // @brief Sets tiles without mines to have numbers representing how many
   // mines are nearby.
-  void m_set_numbered_tiles() {
-    for (auto i = m_next_mine(0); i < tile_count(); i = m_next_mine(i + 1)) {
-      m_promote_tile(i - m_width);
-      m_promote_tile(i + m_width);
-      // If (index isn't against the right side wall). These indexes wrap
-      // around the board to the otherside if %idx is next to the left side
-      // wall.
-      if (i % m_width != 0) {
-        m_promote_tile(i - m_width - 1);
-        m_promote_tile(i - 1);
-        m_promote_tile(i + m_width - 1);
-      }
-      // If (index isn't against the right side wall). These indexes wrap
-      // around the board to the otherside if %idx is next to the right side
-      // wall.
-      if (i % m_width != m_width - 1) {
-        m_promote_tile(i - m_width + 1);
-        m_promote_tile(i + 1);
-        m_promote_tile(i + m_width + 1);
-      }
+  void m_set_numbered_tiles(
+      NumberKernel::Kernel kernel = NumberKernel::AUTO) {
+    const auto stride = m_width + 2;
+    // Mine plane with a zero border, followed by scratch for row sums.
+    m_number_plane.assign(stride * (m_height + 3), 0);
+    m_number_counts.resize(tile_count());
+    for (size_type y = 0, i = 0; y < m_height; ++y) {
+      auto* row = &m_number_plane[(y + 1) * stride + 1];
+      for (size_type x = 0; x < m_width; ++x, ++i)
+        row[x] = m_tiles[i].is_mine();
     }
+    NumberKernel::count(m_number_plane.data(), m_width, m_height,
+                        &m_number_plane[stride * (m_height + 2)],
+                        m_number_counts.data(), kernel);
+    for (size_type i = 0; i < tile_count(); ++i)
+      if (!m_tiles[i].is_mine())
+        m_tiles[i].value(m_number_counts[i]);
   }
 
   void m_set_numbered_tiles_pos() {
@@ -471,81 +980,43 @@ public:
 
   // @brief Returns the amount of neighbours tile has inside bounds of the
   // board.
-  constexpr size_type m_neighbour_count(size_type idx) const noexcept {
-    const bool vertical_edge =
-                   idx % m_width == 0 || idx % m_width == m_width - 1,
-               horizontal_edge =
-                   idx < m_width || idx >= m_height * (m_width - 1);
-    // If is against both vertically and horizontally going walls.
-    if (vertical_edge && horizontal_edge)
-      return 3;
-    // If is against either vertically or horizontally going wall.
-    if (vertical_edge || horizontal_edge)
-      return 5;
-    // If isn't against any walls.
-    return 8;
-  }
-
-  // @brief Returns bounds checked neighbours.
-  std::vector<size_type> m_tile_neighbours_bnds(size_type idx) const {
-    std::vector<size_type> rv;
-    rv.reserve(m_neighbour_count(idx));
-    const bool up_edge = idx >= m_width && idx < tile_count(),
-               bottom_edge = idx < (tile_count() - m_width);
-    if (up_edge)
-      rv.emplace_back(idx - m_width);
-    if (bottom_edge)
-      rv.emplace_back(idx + m_width);
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the left side wall.
-    if (idx % m_width != 0) {
-      if (up_edge)
-        rv.emplace_back(idx - m_width - 1);
-      rv.emplace_back(idx - 1);
-      if (bottom_edge)
-        rv.emplace_back(idx + m_width - 1);
-    }
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the right side wall.
-    if (idx % m_width != m_width - 1) {
-      if (up_edge)
-        rv.emplace_back(idx - m_width + 1);
-      rv.emplace_back(idx + 1);
-      if (bottom_edge)
-        rv.emplace_back(idx + m_width + 1);
-    }
-    return rv;
+  size_type m_neighbour_count(size_type idx) const noexcept {
+    return bit_count(m_neighbour_masks[idx]);
   }
 
-  // @brief Returns bounds checked neighbours.
-  void m_tile_neighbours_bnds(std::vector<size_type>& vec,
-                              size_type idx) const {
-    const bool up_edge = idx >= m_width && idx < tile_count(),
-               bottom_edge = idx < (tile_count() - m_width);
-    if (up_edge)
-      vec.emplace_back(idx - m_width);
-    if (bottom_edge)
-      vec.emplace_back(idx + m_width);
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the left side wall.
-    if (idx % m_width != 0) {
-      if (up_edge)
-        vec.emplace_back(idx - m_width - 1);
-      vec.emplace_back(idx - 1);
-      if (bottom_edge)
-        vec.emplace_back(idx + m_width - 1);
-    }
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the right side wall.
-    if (idx % m_width != m_width - 1) {
-      if (up_edge)
-        vec.emplace_back(idx - m_width + 1);
-      vec.emplace_back(idx + 1);
-      if (bottom_edge)
-        vec.emplace_back(idx + m_width + 1);
+  // @brief Builds neighbour direction masks and offsets for current board
+  // dimensions.
+  void m_build_neighbour_masks() {
+    const auto w = static_cast<diff_type>(m_width);
+    m_neighbour_offsets = {-w - 1, -w, -w + 1, -1, 1, w - 1, w, w + 1};
+    // Directions pointing left, right, up and down respectively.
+    constexpr unsigned char LEFT = 0b00101001, RIGHT = 0b10010100,
+                            UP = 0b00000111, DOWN = 0b11100000;
+    m_neighbour_masks.resize(tile_count());
+    for (size_type y = 0, i = 0; y < m_height; ++y) {
+      unsigned char row_mask = 0xFF;
+      if (y == 0)
+        row_mask &= ~UP;
+      if (y == m_height - 1)
+        row_mask &= ~DOWN;
+      for (size_type x = 0; x < m_width; ++x, ++i) {
+        unsigned char mask = row_mask;
+        if (x == 0)
+          mask &= ~LEFT;
+        if (x == m_width - 1)
+          mask &= ~RIGHT;
+        m_neighbour_masks[i] = mask;
+      }
     }
   }
 
+  // @brief Returns bounds checked neighbours. Allocates; prefer
+  // %neighbours for iteration.
+  std::vector<size_type> m_tile_neighbours_bnds(size_type idx) const {
+    auto range = neighbours(idx);
+    return std::vector<size_type>(range.begin(), range.end());
+  }
+
   std::vector<pos_type> m_tile_neighbours_bnds(pos_type pos) const {
     std::vector<pos_type> rv;
     for (const auto& unbnd : m_tile_neighbours_unbnds(pos))
@@ -554,40 +1025,6 @@ public:
     return rv;
   }
 
-  // @brief Takes a vector of neighbour indexes and does bound checking for
-  // the contained indexes. Returns said vector as reference.
-  void m_tile_neighbours_bnds(std::vector<size_type>& neighbr_unbnds) const {
-    for (size_type i = 0; i < neighbr_unbnds.size(); ++i)
-      if (!m_b_inside_bounds(neighbr_unbnds[i]))
-        neighbr_unbnds.erase(neighbr_unbnds.begin() + i);
-  }
-
-  // @brief Returns a vector containing index's neighbours. Doesn't do bound
-  // checking; check %m_tile_neighbours_bnds for that.
-  // @note Returns as a vector because positions have to be partially bounds
-  // checked and therefore output vector size cannot be determined at compile
-  // time.
-  std::vector<size_type> m_tile_neighbours_unbnds(size_type idx) const {
-    std::vector<size_type> rv;
-    rv.emplace_back(idx - m_width);
-    rv.emplace_back(idx + m_width);
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the left side wall.
-    if (idx % m_width != 0) {
-      rv.emplace_back(idx - m_width - 1);
-      rv.emplace_back(idx - 1);
-      rv.emplace_back(idx + m_width - 1);
-    }
-    // If (index isn't against the right side wall). These indexes wrap around
-    // the board to the otherside if %idx is next to the right side wall.
-    if (idx % m_width != m_width - 1) {
-      rv.emplace_back(idx - m_width + 1);
-      rv.emplace_back(idx + 1);
-      rv.emplace_back(idx + m_width + 1);
-    }
-    return rv;
-  }
-
   static constexpr std::array<pos_type, TILE_NEIGHBOUR_COUNT>
   m_tile_neighbours_unbnds(pos_type pos) noexcept {
     return std::array<pos_type, TILE_NEIGHBOUR_COUNT>{
@@ -596,72 +1033,141 @@ public:
          pos + pos_type{0, 1}, pos + pos_type{1, 1}}};
   }
 
-  void m_flood_open(size_type idx) {
-    if (m_tiles[idx].is_open()) {
-      auto neighbrs = m_tile_neighbours_bnds(idx);
-      size_type flagged_neighbrs = 0;
-      for (auto i : neighbrs)
-        if (m_tiles[i].is_flagged())
-          ++flagged_neighbrs;
-      if (flagged_neighbrs >= m_tiles[idx].value())
-        for (auto i : neighbrs) {
-          m_open_single_tile(i);
-          m_open_neighbours(m_empty_tiles_empty_area(i));
+  // @brief Opens tile at %idx. If tile is already open and has at least as
+  // many flagged neighbours as its value, opens its neighbours instead.
+  // Returns the amount of opened tiles.
+  size_type m_flood_open(size_type idx) {
+    if (!m_tiles[idx].is_open())
+      return m_flood_open_area(idx);
+    size_type opened = 0;
+    if (m_flagged_neighbours[idx] >= m_tiles[idx].value())
+      for (auto i : neighbours(idx))
+        opened += m_flood_open_area(i);
+    return opened;
+  }
+
+  // @brief Opens tile at %idx and, if it's empty, the whole connected empty
+  // area with its numbered border in a single pass. Area is filled a row span
+  // at a time. Flagged tiles are neither opened nor expanded. Returns the
+  // amount of opened tiles.
+  size_type m_flood_open_area(size_type idx) {
+    if (m_tiles[idx].is_flagged() || m_tiles[idx].is_open())
+      return 0;
+    if (!m_tiles[idx].is_empty())
+      return m_open_single_tile(idx) ? 1 : 0;
+    if (b_regions_labelled() && m_region_flags[m_region_of[idx]] == 0)
+      return m_open_region(m_region_of[idx]);
+
+    const auto epoch = m_next_flood_epoch();
+    size_type opened = 0;
+    m_flood_stamps[idx] = epoch;
+    m_flood_seeds.clear();
+    m_flood_seeds.emplace_back(idx);
+
+    while (!m_flood_seeds.empty()) {
+      const auto seed = m_flood_seeds.back();
+      m_flood_seeds.pop_back();
+      const auto row_begin = seed - seed % m_width,
+                 row_end = row_begin + m_width;
+
+      // Extend span to both directions over unvisited closed empty tiles.
+      auto left = seed, right = seed + 1;
+      opened += m_open_single_tile(seed);
+      while (left > row_begin && m_b_flood_expandable(left - 1, epoch)) {
+        m_flood_stamps[--left] = epoch;
+        opened += m_open_single_tile(left);
+      }
+      while (right < row_end && m_b_flood_expandable(right, epoch)) {
+        m_flood_stamps[right] = epoch;
+        opened += m_open_single_tile(right++);
+      }
+
+      // Tiles next to span's ends are its border on the same row.
+      const auto scan_begin = left > row_begin ? left - 1 : left,
+                 scan_end = right < row_end ? right + 1 : right;
+      if (scan_begin != left)
+        opened += m_open_single_tile(scan_begin);
+      if (scan_end != right)
+        opened += m_open_single_tile(right);
+
+      // Rows above and below are either border tiles which are opened or
+      // empty tiles starting new spans.
+      if (row_begin > 0)
+        opened += m_flood_scan_row(scan_begin - m_width, scan_end - m_width,
+                                   epoch);
+      if (row_end < tile_count())
+        opened += m_flood_scan_row(scan_begin + m_width, scan_end + m_width,
+                                   epoch);
+    }
+    return opened;
+  }
+
+  // @brief Opens every tile of labelled opening %region. Returns the amount
+  // of opened tiles.
+  size_type m_open_region(std::uint32_t region) {
+    size_type opened = 0;
+    for (auto r = m_region_offsets[region]; r < m_region_offsets[region + 1];
+         ++r)
+      opened += m_open_single_tile(m_region_tiles[r]);
+    return opened;
+  }
+
+  // @brief Opens non-empty tiles in range [%begin, %end) and adds a span seed
+  // for each run of unvisited closed empty tiles. Returns the amount of
+  // opened tiles.
+  size_type m_flood_scan_row(size_type begin, size_type end,
+                             std::uint32_t epoch) {
+    size_type opened = 0;
+    bool in_run = false;
+    for (auto i = begin; i < end; ++i) {
+      if (m_b_flood_expandable(i, epoch)) {
+        if (!in_run) {
+          m_flood_stamps[i] = epoch;
+          m_flood_seeds.emplace_back(i);
         }
-    } else {
-      m_open_single_tile(idx);
-      if (m_tiles[idx].is_empty())
-        m_open_neighbours(m_empty_tiles_empty_area(idx));
+        in_run = true;
+      } else {
+        opened += m_open_single_tile(i);
+        in_run = false;
+      }
     }
+    return opened;
   }
 
-  // @brief Returns vector of empty tiles that are neighbouring each other
-  // starting from given index.
-  std::vector<size_type> m_empty_tiles_empty_area(size_type idx) {
-    if (!m_tiles[idx].is_empty())
-      return std::vector<size_type>{};
-    if (m_opened_empty_tiles[idx])
-      return std::vector<size_type>{};
-    // Vector to be returned.
-    std::vector<size_type> rv;
-    // Stack for storing neighbouring tile's which are to be checked.
-    std::stack<size_type> st_neigh;
-    // Stores which tiles are already run by the loop.
-    std::vector<bool> checked_tiles(tile_count(), false);
-
-    st_neigh.emplace(idx);
-    while (!st_neigh.empty()) {
-      idx = st_neigh.top();
-      st_neigh.pop();
-      checked_tiles[idx] = true;
-      rv.emplace_back(idx);
-      for (auto n : m_tile_neighbours_bnds(idx))
-        if (m_tiles[n].is_empty() && !m_tiles[n].is_open() && !checked_tiles[n])
-          st_neigh.emplace(n);
-    }
-    for (auto i : rv)
-      m_opened_empty_tiles[i] = true;
-    return rv;
+  // @brief Returns true when tile is closed, unflagged, empty and not yet
+  // visited by flood with given %epoch.
+  bool m_b_flood_expandable(size_type idx, std::uint32_t epoch) const
+      noexcept {
+    const auto& tile = m_tiles[idx];
+    return tile.is_empty() && !tile.is_open() && !tile.is_flagged() &&
+           m_flood_stamps[idx] != epoch;
   }
 
-  // @brief Takes vector of indexes and opens tiles' neighbouring tiles.
-  void m_open_neighbours(const std::vector<size_type>& tiles) {
-    std::vector<size_type> to_open_tiles;
-    for (auto idx : tiles) {
-      auto neighbrs_bnds = m_tile_neighbours_bnds(idx);
-      to_open_tiles.insert(to_open_tiles.end(), neighbrs_bnds.begin(),
-                           neighbrs_bnds.end());
+  // @brief Advances flood epoch so that all tiles count as unvisited without
+  // clearing the stamps. Stamps are cleared only when the epoch wraps around.
+  std::uint32_t m_next_flood_epoch() {
+    if (++m_flood_epoch == 0) {
+      std::fill(m_flood_stamps.begin(), m_flood_stamps.end(), 0);
+      m_flood_epoch = 1;
     }
-    for (auto idx : to_open_tiles)
-      m_open_single_tile(idx);
+    return m_flood_epoch;
   }
 
-  void m_open_single_tile(size_type idx) {
+  // @brief Opens a single unflagged tile. Returns true if the tile was closed
+  // before.
+  bool m_open_single_tile(size_type idx) {
     if (m_tiles[idx].is_flagged())
-      return;
+      return false;
     if (m_tiles[idx].is_mine())
       m_state = GAME_LOSE;
+    if (m_tiles[idx].is_open())
+      return false;
     m_tiles[idx].set_open_unguarded();
+    m_note_changed(idx);
+    ++m_open_count;
+    if (!m_tiles[idx].is_mine())
+      --m_safe_left;
+    return true;
   }
 };
 
@@ -1,28 +1,211 @@
 #ifndef MINEBOARDFORMAT_HPP
 #define MINEBOARDFORMAT_HPP
 
-#include <sstream>
+#include <array>
+#include <charconv>
 #include <string>
 #include <string_view>
 
+#include "boardtile.hpp"
 #include "mineboard.hpp"
 #include "mineraker.hpp"
 
 namespace rake {
 
+/**
+ * @brief Text format of a board's layout and progress. First line holds the
+ * width and height separated by a space and each following line a row of
+ * tiles, one character per tile:
+ *   '.' closed tile       '*' closed mine
+ *   'f' flagged tile      'F' flagged mine
+ *   '0'-'8' open tile     '!' open mine
+ * Open tiles must show the amount of their neighbouring mines. Lines may end
+ * in "\r\n" and the last line break is optional.
+ */
 class MineBoardFormat {
 public:
   MineBoardFormat() {}
   ~MineBoardFormat() {}
 
   static std::string format(const MineBoard& sb) {
-    std::stringstream ss;
-    ss << "[" << sb.mine_count() << "][" << sb.seed() << "];";
-    return ss.str();
+    std::string text = std::to_string(sb.width()) + ' ' +
+                       std::to_string(sb.height()) + '\n';
+    text.reserve(text.size() + (sb.width() + 1) * sb.height());
+    for (size_type i = 0; i < sb.tile_count(); ++i) {
+      text += m_tile_char(sb.m_tiles[i]);
+      if ((i + 1) % sb.width() == 0)
+        text += '\n';
+    }
+    return text;
+  }
+
+  // @brief Returns board parsed from %view. Board is left in %ERROR state if
+  // %view isn't a valid board.
+  static MineBoard parse(std::string_view view) {
+    MineBoard board;
+    parse(view, board);
+    return board;
+  }
+
+  // @brief Parses %view into %board, reusing its storage. Returns false and
+  // leaves %board in %ERROR state if %view isn't a valid board.
+  static bool parse(std::string_view view, MineBoard& board) {
+    if (!m_parse(view, board)) {
+      board.m_state = MineBoard::ERROR;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  // Properties of tile characters.
+  enum CharBits : unsigned char {
+    CHAR_MINE = 1,
+    CHAR_FLAGGED = 2,
+    CHAR_OPEN = 4,
+    CHAR_INVALID = 8,
+  };
+
+  // @brief Returns properties of character %c, a combination of %CharBits.
+  static constexpr unsigned char m_char_bits(unsigned char c) noexcept {
+    switch (c) {
+    case '.':
+      return 0;
+    case '*':
+      return CHAR_MINE;
+    case 'f':
+      return CHAR_FLAGGED;
+    case 'F':
+      return CHAR_MINE | CHAR_FLAGGED;
+    case '!':
+      return CHAR_MINE | CHAR_OPEN;
+    default:
+      return c >= '0' && c <= '8' ? CHAR_OPEN : CHAR_INVALID;
+    }
+  }
+
+  // @brief Returns properties of every character. Looking them up keeps the
+  // parsing loop free of branches.
+  static const std::array<unsigned char, 256>& m_char_table() noexcept {
+    static constexpr auto table = [] {
+      std::array<unsigned char, 256> bits{};
+      for (unsigned c = 0; c < bits.size(); ++c)
+        bits[c] = m_char_bits(static_cast<unsigned char>(c));
+      return bits;
+    }();
+    return table;
+  }
+
+  static char m_tile_char(const BoardTile& tile) noexcept {
+    if (tile.is_open())
+      return tile.is_mine() ? '!' : static_cast<char>('0' + tile.value());
+    if (tile.is_flagged())
+      return tile.is_mine() ? 'F' : 'f';
+    return tile.is_mine() ? '*' : '.';
+  }
+
+  // @brief Reads a number from the start of %view and removes it from %view.
+  static bool m_read_number(std::string_view& view, size_type& number) {
+    auto result = std::from_chars(view.data(), view.data() + view.size(),
+                                  number);
+    if (result.ec != std::errc() || result.ptr == view.data())
+      return false;
+    view.remove_prefix(result.ptr - view.data());
+    return true;
+  }
+
+  // @brief Removes a line break from the start of %view. At the end of %view
+  // a missing line break is accepted when %b_last is set.
+  static bool m_read_line_end(std::string_view& view, bool b_last) {
+    if (!view.empty() && view.front() == '\r')
+      view.remove_prefix(1);
+    if (view.empty())
+      return b_last;
+    if (view.front() != '\n')
+      return false;
+    view.remove_prefix(1);
+    return true;
+  }
+
+  static bool m_parse(std::string_view view, MineBoard& board) {
+    size_type width = 0, height = 0;
+    if (!m_read_number(view, width) || view.empty() || view.front() != ' ')
+      return false;
+    view.remove_prefix(1);
+    // Rows must fit in the text, checked without multiplying the untrusted
+    // dimensions, which could overflow.
+    if (!m_read_number(view, height) || !m_read_line_end(view, false) ||
+        width == 0 || height == 0 || width > view.size() / height)
+      return false;
+
+    board.init(width, height, 0, 0);
+    // Rows are checked twice: first for mines and states, then, once values
+    // are known, for the values shown by open tiles.
+    const auto rows = view;
+    size_type mine_count = 0;
+    bool b_lost = false;
+    const auto& char_table = m_char_table();
+    for (size_type y = 0; y < height; ++y) {
+      if (view.size() < width)
+        return false;
+      // Tiles are written through a plain pointer, as otherwise every write
+      // could alias the characters and the vector would be reloaded.
+      const auto* row = reinterpret_cast<const unsigned char*>(view.data());
+      auto* tiles = board.m_tiles.data() + y * width;
+      unsigned char seen = 0;
+      for (size_type x = 0; x < width; ++x) {
+        const auto bits = char_table[row[x]];
+        const bool b_mine = bits & CHAR_MINE;
+        const BoardTile tile(b_mine ? BoardTile::TILE_MINE
+                                    : BoardTile::TILE_EMPTY,
+                             bits & CHAR_FLAGGED, bits & CHAR_OPEN);
+        tiles[x] = tile;
+        mine_count += b_mine;
+        b_lost |= b_mine && (bits & CHAR_OPEN);
+        seen |= bits;
+      }
+      if (seen & CHAR_INVALID)
+        return false;
+      view.remove_prefix(width);
+      if (!m_read_line_end(view, y + 1 == height))
+        return false;
+    }
+    while (!view.empty() && (view.front() == '\n' || view.front() == '\r'))
+      view.remove_prefix(1);
+    if (!view.empty())
+      return false;
+
+    board.m_mine_count = mine_count;
+    board.m_set_numbered_tiles();
+    view = rows;
+    bool b_wrong_value = false;
+    for (size_type y = 0; y < height; ++y) {
+      const auto* row = reinterpret_cast<const unsigned char*>(view.data());
+      const auto* tiles = board.m_tiles.data() + y * width;
+      for (size_type x = 0; x < width; ++x)
+        b_wrong_value |= tiles[x].is_open() & !tiles[x].is_mine() &
+                         (tiles[x].value() != row[x] - '0');
+      view.remove_prefix(width);
+      m_read_line_end(view, true);
+    }
+    if (b_wrong_value)
+      return false;
+
+    board.m_recount();
+    if (board.m_b_label_regions)
+      board.m_label_regions();
+    if (b_lost)
+      board.m_state = MineBoard::GAME_LOSE;
+    else if (board.m_safe_left == 0)
+      board.m_state = MineBoard::GAME_WIN;
+    else
+      board.m_state = MineBoard::NEXT_MOVE;
+    board.m_note_all_changed();
+    board.m_notify_observers();
+    return true;
   }
-  // static MineBoard parse(std::string_view view) { return MineBoard{}; }
 };
 
 } // namespace rake
 
-#endif
\ No newline at end of file
+#endif
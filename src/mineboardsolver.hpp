@@ -2,13 +2,21 @@
 #define MINEBOARDSOLVER_HPP
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <limits>
 #include <vector>
 
+#include "bitboard.hpp"
 #include "boardtile.hpp"
+#include "cdclsolver.hpp"
+#include "componentcache.hpp"
+#include "frontier.hpp"
+#include "frontiereliminator.hpp"
+#include "frontierenumerator.hpp"
 #include "mineboard.hpp"
 #include "mineraker.hpp"
-#include "vectorspace.hpp"
 
 namespace rake {
 
@@ -17,6 +25,29 @@ namespace rake {
  * inside the MineBoard.
  */
 class MineBoardSolver {
+public:
+  using clock_type = FrontierEnumerator::clock_type;
+
+  // Suggested move for a player or a bot.
+  struct Hint {
+    enum Kind {
+      // No move is left or none was found in time.
+      NONE,
+      // Tile is known to be safe.
+      SAFE,
+      // Tile is known to be a mine.
+      MINE,
+      // Nothing is known, so the tile is the least likely mine found.
+      GUESS,
+    };
+
+    Kind kind = NONE;
+    size_type idx = 0;
+    // Mine probability of the tile, estimated from the mine density if
+    // there was no time to compute it.
+    double probability = 0.0;
+  };
+
 private:
   using this_type = MineBoardSolver;
 
@@ -26,18 +57,115 @@ private:
   // with already checked ones.
   std::vector<bool> m_checked_number_tiles;
 
-  VectorSpace<size_type> m_vecspace;
+  // Open numbered tile as a constraint on its closed unflagged neighbours.
+  struct Constraint {
+    // Unknown neighbours in the direction order of the board's neighbour
+    // masks.
+    unsigned char mask;
+    // Amount of mines left among the unknown neighbours.
+    int mines;
+  };
+
+  // Unknown tiles as constraints for %m_enumerator, rebuilt for each
+  // enumeration.
+  Frontier m_frontier;
+  FrontierEliminator m_eliminator;
+  FrontierEnumerator m_enumerator;
+  // Frontier cell of each unknown tile while building %m_frontier.
+  std::vector<size_type> m_cell_of;
+  // Verdicts of the last elimination or enumeration, the latter completed by
+  // the SAT backend.
+  std::vector<FrontierEnumerator::Verdict> m_verdicts;
+
+  // Optional backend for components too large to enumerate. Cells of those
+  // components are its variables and the constraints on them its clauses.
+  CdclSolver m_sat;
+  bool m_b_sat_backend;
+  std::vector<size_type> m_sat_cells;
+  // Variable of each frontier cell, or %m_sat_cells.size() if it has none.
+  std::vector<size_type> m_sat_vars;
+
+  // Frontier tiles to propagate in %b_solve. Fed by board changes.
+  std::vector<size_type> m_dirty;
+  // Marks tiles in %m_dirty.
+  std::vector<unsigned char> m_b_dirty;
+  // Set when the whole board has changed and the frontier must be rebuilt.
+  bool m_b_rescan;
+  // Tile states as bit planes for scanning the whole board a word at a time.
+  // Kept up to date by board changes, or reloaded when stale.
+  BitBoard m_planes;
+  bool m_b_planes_stale;
+  // Unknown tiles, open numbered tiles and tiles next to either, derived
+  // from %m_planes for a scan.
+  BitBoard::plane_type m_unknown;
+  BitBoard::plane_type m_open_numbers;
+  BitBoard::plane_type m_adjacent;
+  // Id of the solver's board observer.
+  size_type m_observer_id;
 
 public:
-  MineBoardSolver(MineBoard& board) : m_board(board) {
-    m_vecspace.space_size(8);
-    m_vecspace.vectors_reserve(8);
+  MineBoardSolver(MineBoard& board)
+      : m_board(board), m_b_sat_backend(false), m_b_rescan(true),
+        m_b_planes_stale(true) {
+    m_observe();
   }
   MineBoardSolver(const this_type& other)
       : m_board(other.m_board),
-        m_checked_number_tiles(other.m_checked_number_tiles) {}
+        m_checked_number_tiles(other.m_checked_number_tiles),
+        m_enumerator(other.m_enumerator.thread_count()),
+        m_b_sat_backend(other.m_b_sat_backend), m_b_rescan(true),
+        m_b_planes_stale(true) {
+    m_enumerator.cache(other.m_enumerator.cache());
+    m_enumerator.deadline(other.m_enumerator.deadline());
+    m_observe();
+  }
   MineBoardSolver(this_type&&) = delete;
-  ~MineBoardSolver() noexcept {}
+  ~MineBoardSolver() noexcept { m_board.unsubscribe(m_observer_id); }
+
+private:
+  void m_observe() {
+    m_observer_id = m_board.subscribe(
+        [this](const MineBoard::Changes& changes) {
+          m_on_board_changes(changes);
+        });
+  }
+
+public:
+  // @brief Sets the amount of threads enumerating large frontier components.
+  // Zero uses a thread per hardware thread. Solvers run by %BoardSearch and
+  // %BoardPool workers are best left with a single thread.
+  void thread_count(unsigned thread_count) {
+    m_enumerator.thread_count(thread_count);
+  }
+
+  unsigned thread_count() const noexcept {
+    return m_enumerator.thread_count();
+  }
+
+  // @brief Makes enumeration reuse results of small frontier components from
+  // %cache, which may be shared with solvers on other threads, and store its
+  // own to it. Null disables caching.
+  void cache(ComponentCache* cache) noexcept { m_enumerator.cache(cache); }
+
+  ComponentCache* cache() const noexcept { return m_enumerator.cache(); }
+
+  // @brief Enables the SAT backend, which decides cells of frontier
+  // components too large to enumerate. Their cells are only constrained by
+  // the numbers around them, so cells forced by the total mine count alone
+  // are left undecided.
+  void sat_backend(bool b_enabled) noexcept { m_b_sat_backend = b_enabled; }
+
+  bool b_sat_backend() const noexcept { return m_b_sat_backend; }
+
+  // @brief Makes enumeration give up on frontier components once %deadline
+  // has passed. Their cells are then left to the SAT backend, if enabled.
+  void deadline(clock_type::time_point deadline) noexcept {
+    m_enumerator.deadline(deadline);
+  }
+
+  clock_type::time_point deadline() const noexcept {
+    return m_enumerator.deadline();
+  }
 
   void reset() {
     for (auto checked : m_checked_number_tiles)
@@ -54,20 +182,12 @@ public:
   }
 
   auto flagged_neighbours_count(size_type idx) {
-    size_type count = 0;
-    auto neighbrs = m_vecspace.acquire();
-    m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-    for (auto i : *neighbrs.get())
-      if (m_board.m_tiles[i].is_flagged())
-        ++count;
-    return count;
+    return m_board.flagged_neighbours_count(idx);
   }
 
   auto flagged_not_neighbours_count(size_type idx) {
     size_type count = 0;
-    auto neighbrs = m_vecspace.acquire();
-    m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-    for (auto i : *neighbrs.get())
+    for (auto i : m_board.neighbours(idx))
       if (!m_board.m_tiles[i].is_flagged())
         ++count;
     return count;
@@ -75,9 +195,7 @@ public:
 
   auto open_neighbours_count(size_type idx) {
     size_type count = 0;
-    auto neighbrs = m_vecspace.acquire();
-    m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-    for (auto i : *neighbrs.get())
+    for (auto i : m_board.neighbours(idx))
       if (m_board.m_tiles[i].is_open())
         ++count;
     return count;
@@ -85,9 +203,7 @@ public:
 
   auto open_not_neighbours_count(size_type idx) {
     size_type count = 0;
-    auto neighbrs = m_vecspace.acquire();
-    m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-    for (auto i : *neighbrs.get())
+    for (auto i : m_board.neighbours(idx))
       if (!m_board.m_tiles[i].is_open())
         ++count;
     return count;
@@ -95,9 +211,7 @@ public:
 
   auto not_flagged_not_open_neighbours_count(size_type idx) {
     size_type count = 0;
-    auto neighbrs = m_vecspace.acquire();
-    m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-    for (auto i : *neighbrs.get())
+    for (auto i : m_board.neighbours(idx))
       if (!(m_board.m_tiles[i].is_flagged() || m_board.m_tiles[i].is_open()))
         ++count;
     return count;
@@ -125,13 +239,13 @@ public:
 
   // @brief Finds common neighbours between two tiles using indexes.
   auto common_neighbours(size_type idx1, size_type idx2) {
-    auto vec1 = m_board.m_tile_neighbours_bnds(idx1),
-         vec2 = m_board.m_tile_neighbours_bnds(idx2);
-    // %m_tiles_neighbours_bnds(size_type) returns unsorted data so it has to be
-    // sorted.
-    std::sort(vec1.begin(), vec1.end());
-    std::sort(vec2.begin(), vec2.end());
-    return common_idxs(vec1, vec2);
+    // Neighbour ranges are iterated in ascending order so no sorting is
+    // needed.
+    auto range1 = m_board.neighbours(idx1), range2 = m_board.neighbours(idx2);
+    std::vector<size_type> rv;
+    std::set_intersection(range1.begin(), range1.end(), range2.begin(),
+                          range2.end(), std::back_inserter(rv));
+    return rv;
   }
 
   auto common_neighbours(MineBoard::pos_type pos1, MineBoard::pos_type pos2) {
@@ -165,227 +279,606 @@ public:
         }
       }
     }
+    m_board.m_notify_observers();
     return b_state_changed;
   }
 
-  // @brief Compares each tile's value to it's unopened neighbour tile count and
-  // flag those if they are equal.
-  auto b_overlap_solve() {
+  // @brief Applies constraint propagation once to every frontier tile.
+  // @return Whether something was changed.
+  bool b_constraint_solve() {
     bool b_state_changed = false;
-    auto& tiles = m_board.m_tiles;
+    for (size_type idx = 0; idx < m_board.tile_count(); ++idx)
+      if (m_b_frontier(idx))
+        b_state_changed |= m_propagate_at(idx);
+    m_board.m_notify_observers();
+    return b_state_changed;
+  }
+
+  // @brief Reduces the constraints of the unknown tiles by Gaussian
+  // elimination and flags or opens the tiles the reduced constraints decide.
+  // Costs a fraction of enumeration but doesn't decide as much.
+  // @return Whether something was changed.
+  bool b_elimination_solve() {
+    if (m_board.state() != MineBoard::NEXT_MOVE || !m_build_frontier() ||
+        !m_eliminator.solve(m_frontier))
+      return false;
+    m_verdicts.resize(m_frontier.cells.size());
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      m_verdicts[i] = m_eliminator.cell(i);
+    return m_b_apply_verdicts(FrontierEnumerator::UNDECIDED);
+  }
+
+  // @brief Enumerates every solution of the unknown tiles and flags or opens
+  // those which all solutions agree on. Board isn't touched until the
+  // enumeration is done.
+  // @return Whether something was changed.
+  bool b_enumerate_solve() {
+    if (m_board.state() != MineBoard::NEXT_MOVE || !m_build_frontier() ||
+        !m_enumerator.solve(m_frontier))
+      return false;
+    m_verdicts.resize(m_frontier.cells.size());
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      m_verdicts[i] = m_enumerator.cell(i);
+    if (m_b_sat_backend && !m_b_sat_decide())
+      return false;
+    return m_b_apply_verdicts(m_enumerator.interior());
+  }
+
+  // @brief Stores the mine probability of every tile of the board to
+  // %probabilities, taking every layout of mines which fits the open tiles
+  // and flags to be equally likely. Open tiles have zero and flagged tiles
+  // a probability of one. Returns false if the open tiles and flags don't
+  // fit together or the frontier is too large to enumerate.
+  bool mine_probabilities(std::vector<double>& probabilities) {
+    std::vector<double> cells;
+    double interior = 0.0;
+    if (!m_build_frontier() || !m_enumerator.solve(m_frontier) ||
+        !m_enumerator.probabilities(cells, interior))
+      return false;
+    probabilities.resize(m_board.tile_count());
+    for (size_type idx = 0; idx < m_board.tile_count(); ++idx)
+      probabilities[idx] = m_board.m_tiles[idx].is_flagged() ? 1.0 : 0.0;
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      probabilities[m_frontier.cells[i]] = cells[i];
+    for (auto idx : m_frontier.interior)
+      probabilities[idx] = interior;
+    return true;
+  }
+
+  // @brief Returns the closed unflagged tile least likely to be a mine.
+  // Frontier cells are preferred on ties as opening them tells more. Returns
+  // %tile_count() if there is no such tile or the probabilities couldn't be
+  // computed.
+  size_type safest_tile() {
+    std::vector<double> probabilities;
+    auto safest = m_board.tile_count();
+    if (!mine_probabilities(probabilities))
+      return safest;
+    for (auto idx : m_frontier.cells)
+      if (safest == m_board.tile_count() ||
+          probabilities[idx] < probabilities[safest])
+        safest = idx;
+    for (auto idx : m_frontier.interior)
+      if (safest == m_board.tile_count() ||
+          probabilities[idx] < probabilities[safest])
+        safest = idx;
+    return safest;
+  }
+
+  // @brief Propagates constraints until nothing more can be deduced, then
+  // eliminates and, if that doesn't help, enumerates, until none of them
+  // changes the board. Returns true if elimination or enumeration was
+  // needed. Constraints are only propagated from frontier tiles near changes
+  // since the previous call, so the work done is proportional to the changes
+  // instead of the board size.
+  auto b_solve() {
+    bool b_deduced = false;
+    for (;;) {
+      m_solve_frontier();
+      if (!b_elimination_solve() && !b_enumerate_solve())
+        return b_deduced;
+      b_deduced = true;
+    }
+  }
+
+  // @brief Returns a move without making it, trying constraint propagation,
+  // elimination, enumeration and mine probabilities in turn until one of
+  // them finds something or %budget runs out. Best move found by then is
+  // returned, so the time taken stays close to %budget however large the
+  // board is. SAT backend isn't used, as its time isn't bounded.
+  Hint hint(clock_type::duration budget) {
+    const auto now = clock_type::now();
+    const auto deadline = budget >= clock_type::time_point::max() - now
+                              ? clock_type::time_point::max()
+                              : now + budget;
+    Hint best;
+    if (m_board.state() != MineBoard::NEXT_MOVE ||
+        m_board.flagged_tiles_count() > m_board.mine_count())
+      return best;
+    const auto unknown = m_board.tile_count() - m_board.open_tiles_count() -
+                         m_board.flagged_tiles_count();
+    const auto density =
+        unknown == 0 ? 0.0
+                     : static_cast<double>(m_board.mine_count() -
+                                           m_board.flagged_tiles_count()) /
+                           unknown;
+
+    // First unknown tile met is a guess until something better is found.
+    Deduction deduction;
     for (size_type idx = 0; idx < m_board.tile_count(); ++idx) {
-      if (tiles[idx].is_open() && tiles[idx].is_number()) {
-        // auto neighbrs = m_board.m_tile_neighbours_bnds(idx);
-        auto neighbrs = m_vecspace.acquire();
-        m_board.m_tile_neighbours_bnds(*neighbrs.get(), idx);
-        // std::vector<size_type> nobrs;
-        auto nobrs = m_vecspace.acquire();
-        // Finds not opened neighbours of current tile.
-        for (auto& i : *neighbrs.get())
-          if (!tiles[i].is_open())
-            nobrs->emplace_back(i);
-        // If tile's value equals the number of unopened neighbours, those
-        // neighbours must be mines. If neighbour is unflagged, it will be
-        // flagged.
-        if (tiles[idx].value() == nobrs->size()) {
-          for (auto nidx : *nobrs.get()) {
-            if (!tiles[nidx].is_flagged()) {
-              tiles[nidx].set_flagged_unguarded();
-              b_state_changed = true;
-            }
-          }
+      if (idx % HINT_CHECK_TILES == 0 && clock_type::now() >= deadline)
+        return best;
+      if (best.kind == Hint::NONE && is_not_flagged_open(idx)) {
+        best.kind = Hint::GUESS;
+        best.idx = idx;
+        best.probability = density;
+      }
+      if (m_b_frontier(idx) && m_b_find_deduction(idx, deduction))
+        return m_hint(deduction);
+    }
+
+    if (best.kind == Hint::NONE || clock_type::now() >= deadline ||
+        !m_build_frontier() || !m_eliminator.solve(m_frontier, deadline))
+      return best;
+    m_verdicts.resize(m_frontier.cells.size());
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      m_verdicts[i] = m_eliminator.cell(i);
+    if (m_b_verdict_hint(FrontierEnumerator::UNDECIDED, best) ||
+        clock_type::now() >= deadline)
+      return best;
+
+    const auto saved = m_enumerator.deadline();
+    m_enumerator.deadline(std::min(deadline, saved));
+    const bool b_solved = m_enumerator.solve(m_frontier);
+    m_enumerator.deadline(saved);
+    if (!b_solved)
+      return best;
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      m_verdicts[i] = m_enumerator.cell(i);
+    if (m_b_verdict_hint(m_enumerator.interior(), best))
+      return best;
+
+    std::vector<double> cells;
+    double interior = 0.0;
+    if (!m_enumerator.probabilities(cells, interior))
+      return best;
+    best.probability = 1.0;
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      if (cells[i] < best.probability) {
+        best.idx = m_frontier.cells[i];
+        best.probability = cells[i];
+      }
+    if (!m_frontier.interior.empty() && interior < best.probability) {
+      best.idx = m_frontier.interior.front();
+      best.probability = interior;
+    }
+    return best;
+  }
+
+private:
+  // Tiles scanned for propagation between checks of the hint deadline.
+  static constexpr size_type HINT_CHECK_TILES = 1024;
+
+  // One deduction from one or two constraints: unknown neighbours of tile
+  // %mines_at in directions %mines are mines and those of tile %safe_at in
+  // directions %safe are safe.
+  struct Deduction {
+    size_type mines_at;
+    unsigned char mines;
+    size_type safe_at;
+    unsigned char safe;
+  };
+
+  // @brief Returns the hint of %deduction, preferring a safe tile.
+  Hint m_hint(const Deduction& deduction) const {
+    const auto* offsets = m_board.m_neighbour_offsets.data();
+    Hint hint;
+    if (deduction.safe != 0) {
+      hint.kind = Hint::SAFE;
+      hint.idx = *MineBoard::neighbour_range(deduction.safe_at,
+                                             deduction.safe, offsets)
+                      .begin();
+    } else {
+      hint.kind = Hint::MINE;
+      hint.idx = *MineBoard::neighbour_range(deduction.mines_at,
+                                             deduction.mines, offsets)
+                      .begin();
+      hint.probability = 1.0;
+    }
+    return hint;
+  }
+
+  // @brief Sets %hint to a tile %m_verdicts or %interior decides, preferring
+  // safe tiles. Returns false and leaves %hint as it was if they decide
+  // nothing.
+  bool m_b_verdict_hint(FrontierEnumerator::Verdict interior,
+                        Hint& hint) const {
+    for (auto verdict : {FrontierEnumerator::SAFE, FrontierEnumerator::MINE}) {
+      auto idx = m_board.tile_count();
+      for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+        if (m_verdicts[i] == verdict) {
+          idx = m_frontier.cells[i];
+          break;
         }
+      if (idx == m_board.tile_count() && interior == verdict &&
+          !m_frontier.interior.empty())
+        idx = m_frontier.interior.front();
+      if (idx != m_board.tile_count()) {
+        const bool b_safe = verdict == FrontierEnumerator::SAFE;
+        hint.kind = b_safe ? Hint::SAFE : Hint::MINE;
+        hint.idx = idx;
+        hint.probability = b_safe ? 0.0 : 1.0;
+        return true;
       }
     }
-    return b_state_changed;
+    return false;
   }
 
-  // @todo Comment steps in the algorithm.
-  auto b_pattern_solve() {
-    bool b_state_changed = false;
-    auto& tiles = m_board.m_tiles;
+  // @brief Propagates constraints of queued frontier tiles until the queue
+  // is empty.
+  void m_solve_frontier() {
+    // Changes made outside the solver are queued first.
+    m_board.m_notify_observers();
+    if (m_b_rescan)
+      m_queue_frontier();
+    while (!m_dirty.empty() && m_board.state() == MineBoard::NEXT_MOVE) {
+      const auto idx = m_dirty.back();
+      m_dirty.pop_back();
+      m_b_dirty[idx] = false;
+      // Tile is queued again as only one deduction is made at a time.
+      if (m_b_frontier(idx) && m_propagate_at(idx))
+        m_queue(idx);
+      // Tiles changed by the deduction are queued by the observer.
+      m_board.m_notify_observers();
+    }
+  }
 
-    for (size_type i = 0; i < m_board.tile_count(); ++i) {
-      if (tiles[i].is_open() && tiles[i].is_number()) {
-        auto i_neighbrs = m_vecspace.acquire();
-        m_board.m_tile_neighbours_bnds(*i_neighbrs.get(), i);
-        for (auto n : *i_neighbrs.get()) {
-          if (tiles[n].is_open() && tiles[n].is_number()) {
-            auto neighbrs = m_vecspace.acquire();
-            for (auto neigh : *i_neighbrs.get())
-              if (!(tiles[neigh].is_open() || tiles[neigh].is_flagged()))
-                neighbrs->emplace_back(neigh);
-
-            auto n_neighbrs_open_flagged = m_vecspace.acquire();
-            auto n_neighbrs = m_vecspace.acquire();
-            m_board.m_tile_neighbours_bnds(*n_neighbrs.get(), n);
-            for (auto neigh : *n_neighbrs.get())
-              if (!(tiles[neigh].is_open() || tiles[neigh].is_flagged()))
-                n_neighbrs_open_flagged->emplace_back(neigh);
-
-            // Sort vectors so that %std::set_difference returns correct result.
-            std::sort(neighbrs->begin(), neighbrs->end());
-            std::sort(n_neighbrs_open_flagged->begin(),
-                      n_neighbrs_open_flagged->end());
-
-            auto flag_neighbrs = m_vecspace.acquire();
-            std::set_difference(neighbrs->begin(), neighbrs->end(),
-                                n_neighbrs_open_flagged->begin(),
-                                n_neighbrs_open_flagged->end(),
-                                std::back_inserter(*flag_neighbrs.get()));
-            if (tiles[i].value() - flagged_neighbours_count(i) -
-                        tiles[n].value() + flagged_neighbours_count(n) ==
-                    1 &&
-                flag_neighbrs->size() == 1) {
-              tiles[flag_neighbrs->front()].set_flagged();
-              b_state_changed = true;
-            }
-          }
+  // @brief Opens tile %idx known to be safe unless an earlier opening has
+  // already opened it, as opening an open tile would chord it.
+  void m_open_safe(size_type idx) {
+    if (!m_board.m_tiles[idx].is_open())
+      m_board.m_on_next_move(idx);
+  }
+
+  // @brief Gathers the constraints of the board into %m_frontier. Returns
+  // false if there are more flags than mines.
+  bool m_build_frontier() {
+    m_frontier.clear();
+    if (m_board.flagged_tiles_count() > m_board.mine_count())
+      return false;
+    m_frontier.mines_left =
+        m_board.mine_count() - m_board.flagged_tiles_count();
+    m_cell_of.resize(m_board.tile_count());
+    // Unknown tiles next to open numbered ones are the frontier cells.
+    m_scan_planes();
+    m_planes.adjacent(m_open_numbers, m_adjacent);
+    for (size_type w = 0; w < m_unknown.size(); ++w)
+      for (auto bits = m_unknown[w]; bits != 0; bits &= bits - 1) {
+        const auto bit = bit_scan(bits);
+        const auto idx = w * BitBoard::WORD_BITS + bit;
+        if ((m_adjacent[w] >> bit) & 1) {
+          m_cell_of[idx] = m_frontier.cells.size();
+          m_frontier.cells.emplace_back(idx);
+        } else {
+          m_frontier.interior.emplace_back(idx);
         }
       }
+    for (size_type w = 0; w < m_open_numbers.size(); ++w)
+      for (auto bits = m_open_numbers[w]; bits != 0; bits &= bits - 1) {
+        const auto idx = w * BitBoard::WORD_BITS + bit_scan(bits);
+        const auto constraint = m_constraint(idx);
+        if (constraint.mask == 0)
+          continue;
+        for (auto n : MineBoard::neighbour_range(
+                 idx, constraint.mask, m_board.m_neighbour_offsets.data()))
+          m_frontier.constraint_cells.emplace_back(m_cell_of[n]);
+        m_frontier.constraint_offsets.emplace_back(
+            m_frontier.constraint_cells.size());
+        m_frontier.constraint_mines.emplace_back(constraint.mines);
+      }
+    m_frontier.link();
+    return true;
+  }
+
+  // @brief Brings %m_planes up to date with the board and derives the
+  // planes of unknown and open numbered tiles from it.
+  void m_scan_planes() {
+    m_board.m_notify_observers();
+    if (m_b_planes_stale) {
+      m_planes.load(m_board);
+      m_b_planes_stale = false;
     }
-    return b_state_changed;
+    m_planes.unknown(m_unknown);
+    m_planes.numbers(m_open_numbers);
+    const auto& open = m_planes.open();
+    for (size_type w = 0; w < open.size(); ++w)
+      m_open_numbers[w] &= open[w];
   }
 
-  // @brief Opens tiles that can't be mines based on tile value pairs.
+  // @brief Flags frontier cells with %MINE verdicts and opens those with
+  // %SAFE verdicts, and does the same to the interior by %interior.
   // @return Whether something was changed.
-  auto b_common_solve() {
+  bool m_b_apply_verdicts(FrontierEnumerator::Verdict interior) {
     bool b_state_changed = false;
-    auto& tiles = m_board.m_tiles;
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      if (m_verdicts[i] == FrontierEnumerator::MINE) {
+        m_board.m_set_flag(m_frontier.cells[i], true);
+        b_state_changed = true;
+      }
+    if (interior == FrontierEnumerator::MINE) {
+      for (auto idx : m_frontier.interior)
+        m_board.m_set_flag(idx, true);
+      b_state_changed |= !m_frontier.interior.empty();
+    }
+    for (size_type i = 0; i < m_frontier.cells.size(); ++i)
+      if (m_verdicts[i] == FrontierEnumerator::SAFE) {
+        m_open_safe(m_frontier.cells[i]);
+        b_state_changed = true;
+      }
+    if (interior == FrontierEnumerator::SAFE) {
+      for (auto idx : m_frontier.interior)
+        m_open_safe(idx);
+      b_state_changed |= !m_frontier.interior.empty();
+    }
+    m_board.m_notify_observers();
+    return b_state_changed;
+  }
 
-    // Iterate over tiles.
-    for (size_type i = 0; i < m_board.tile_count(); ++i) {
-      if (tiles[i].is_open() && tiles[i].is_number()) {
-        auto i_neighbrs = m_vecspace.acquire();
-        m_board.m_tile_neighbours_bnds(*i_neighbrs.get(), i);
-        // Iterate over tile's neighbours.
-        for (auto n : *i_neighbrs.get()) {
-          if (tiles[n].is_open() && tiles[n].is_number()) {
-            auto n_neighbrs = m_vecspace.acquire();
-            m_board.m_tile_neighbours_bnds(*n_neighbrs.get(), n);
-            // Construct a vector with tile's neighbours indexes that aren't
-            // open nor flagged.
-            auto neighbrs_not_open_flagged = m_vecspace.acquire();
-            auto neighbrs = m_vecspace.acquire();
-            m_board.m_tile_neighbours_bnds(*neighbrs.get(), i);
-            for (auto neigh : *neighbrs.get())
-              if (!(tiles[neigh].is_open() || tiles[neigh].is_flagged()))
-                neighbrs_not_open_flagged->emplace_back(neigh);
-
-            // Reuse temporary vector which isn't used anymore.
-            neighbrs->resize(0);
-            m_board.m_tile_neighbours_bnds(*neighbrs.get(), n);
-            auto n_neighbrs_not_open_flagged = m_vecspace.acquire();
-            for (auto neigh : *neighbrs.get())
-              if (!(tiles[neigh].is_open() || tiles[neigh].is_flagged()))
-                n_neighbrs_not_open_flagged->emplace_back(neigh);
-
-            // %std::set_difference requires sorted data as parameter.
-            std::sort(neighbrs_not_open_flagged->begin(),
-                      neighbrs_not_open_flagged->end());
-            std::sort(n_neighbrs_not_open_flagged->begin(),
-                      n_neighbrs_not_open_flagged->end());
-
-            // Extract difference from %neighbrs and %n_neighbrs vectors and
-            // insert the result to %diff_neighbrs.
-            auto n_diff_neighbrs = m_vecspace.acquire();
-            std::set_difference(neighbrs_not_open_flagged->begin(),
-                                neighbrs_not_open_flagged->end(),
-                                n_neighbrs_not_open_flagged->begin(),
-                                n_neighbrs_not_open_flagged->end(),
-                                std::back_inserter(*n_diff_neighbrs.get()));
-
-            // Check whether %n_neighbrs vector is included in the %neighbrs
-            // vector and tile's value with flagged neighbours substracted
-            // from it equals neighbour's value, also with flagged
-            // neighbours substracted from it.
-            if (std::includes(neighbrs_not_open_flagged->begin(),
-                              neighbrs_not_open_flagged->end(),
-                              n_neighbrs_not_open_flagged->begin(),
-                              n_neighbrs_not_open_flagged->end()) &&
-                tiles[i].value() - flagged_neighbours_count(i) ==
-                    tiles[n].value() - flagged_neighbours_count(n)) {
-              // Open those tiles that are left over from the possible mine
-              // positions.
-              for (auto diff : *n_diff_neighbrs.get()) {
-                m_board.m_on_next_move(diff);
-                b_state_changed = true;
-              }
-            }
-          }
+  // Conflicts after which the SAT backend gives up on a single query.
+  static constexpr size_type SAT_MAX_CONFLICTS = 10000;
+
+  // @brief Decides the cells of components the enumerator gave up on with
+  // the SAT backend, asking for each cell whether the constraints can be
+  // met with its value flipped from a known solution. Returns false if the
+  // constraints have no solution.
+  bool m_b_sat_decide() {
+    m_enumerator.incomplete_cells(m_sat_cells);
+    if (m_sat_cells.empty())
+      return true;
+    const auto count = m_sat_cells.size();
+    m_sat.clear();
+    m_sat_vars.assign(m_frontier.cells.size(), count);
+    for (auto cell : m_sat_cells)
+      m_sat_vars[cell] = m_sat.add_variable();
+
+    // Exactly m of the n cells of a constraint are mines when no m + 1 of
+    // them are and no n - m + 1 of them aren't. Constraints have at most
+    // eight cells, so the subsets are listed as is.
+    std::vector<CdclSolver::literal_type> clause;
+    for (size_type k = 0; k < m_frontier.constraint_count(); ++k) {
+      const auto begin = m_frontier.constraint_offsets[k],
+                 end = m_frontier.constraint_offsets[k + 1];
+      if (m_sat_vars[m_frontier.constraint_cells[begin]] == count)
+        continue;
+      const auto cells = static_cast<int>(end - begin),
+                 mines = m_frontier.constraint_mines[k];
+      if (mines < 0 || mines > cells)
+        return false;
+      for (unsigned subset = 1; subset < (1u << cells); ++subset) {
+        const auto size = static_cast<int>(bit_count(subset));
+        // Both clauses are made of the same subsets when n = 2m.
+        for (int b_mines = 1; b_mines >= 0; --b_mines) {
+          if (size != (b_mines ? mines + 1 : cells - mines + 1))
+            continue;
+          clause.clear();
+          for (int c = 0; c < cells; ++c)
+            if (subset & (1u << c))
+              clause.emplace_back(CdclSolver::literal(
+                  m_sat_vars[m_frontier.constraint_cells[begin + c]],
+                  !b_mines));
+          if (!m_sat.add_clause(clause))
+            return false;
         }
       }
     }
-    return b_state_changed;
+
+    const auto first = m_sat.solve({}, SAT_MAX_CONFLICTS);
+    if (first != CdclSolver::SATISFIABLE)
+      return first == CdclSolver::UNKNOWN;
+    // Each solution found rules out the cells it flips from the first one.
+    std::vector<unsigned char> values(count), b_open(count, true);
+    for (size_type var = 0; var < count; ++var)
+      values[var] = m_sat.model(var);
+    for (size_type var = 0; var < count; ++var) {
+      if (!b_open[var])
+        continue;
+      const auto result = m_sat.solve(
+          {CdclSolver::literal(var, !values[var])}, SAT_MAX_CONFLICTS);
+      if (result == CdclSolver::UNSATISFIABLE) {
+        m_verdicts[m_sat_cells[var]] = values[var] ? FrontierEnumerator::MINE
+                                                   : FrontierEnumerator::SAFE;
+        m_sat.add_clause({CdclSolver::literal(var, values[var])});
+      } else if (result == CdclSolver::SATISFIABLE) {
+        for (auto other = var; other < count; ++other)
+          b_open[other] &= m_sat.model(other) == values[other];
+      }
+    }
+    return true;
   }
 
-  // @brief Tries different combinations and flags based on which results did
-  // not fit to the board. Brute-force method.
-  auto b_suffle_solve() {
-    /**
-     * Try different combinations spanning flag based on %mines_left and
-     * comparing the tiles' values whether they are possible. When all
-     * combinations are tried and only 1 solution is found, set those flags.
-     */
+  void m_queue(size_type idx) {
+    if (!m_b_dirty[idx]) {
+      m_b_dirty[idx] = true;
+      m_dirty.emplace_back(idx);
+    }
+  }
 
-    auto& tiles = m_board.m_tiles;
+  // @brief Queues tiles whose constraints change when %idx changes: %idx
+  // itself and its neighbours.
+  void m_queue_around(size_type idx) {
+    if (m_b_dirty.size() != m_board.tile_count()) {
+      m_b_rescan = true;
+      return;
+    }
+    m_queue(idx);
+    for (auto n : m_board.neighbours(idx))
+      m_queue(n);
+  }
 
-    std::vector<size_type> not_opened;
-    for (size_type i = 0; i < m_board.tile_count(); ++i)
-      if (!(tiles[i].is_open() || tiles[i].is_flagged()))
-        not_opened.emplace_back(i);
+  // @brief Queues every frontier tile of the board: open numbered tiles
+  // next to unknown ones.
+  void m_queue_frontier() {
+    m_scan_planes();
+    m_planes.adjacent(m_unknown, m_adjacent);
+    m_b_rescan = false;
+    m_dirty.clear();
+    m_b_dirty.assign(m_board.tile_count(), false);
+    for (size_type w = 0; w < m_open_numbers.size(); ++w)
+      for (auto bits = m_open_numbers[w] & m_adjacent[w]; bits != 0;
+           bits &= bits - 1)
+        m_queue(w * BitBoard::WORD_BITS + bit_scan(bits));
+  }
 
-    std::vector<bool> flag_bits(not_opened.size(), false);
-    // rbegin() instead of begin() -> no sorting
-    std::fill_n(flag_bits.rbegin(),
-                m_board.mine_count() - m_board.flagged_tiles_count(), true);
+  void m_on_board_changes(const MineBoard::Changes& changes) {
+    if (changes.b_all) {
+      m_b_rescan = true;
+      m_b_planes_stale = true;
+      return;
+    }
+    if (!m_b_planes_stale)
+      for (auto idx : changes)
+        m_planes.update(m_board, idx);
+    if (!m_b_rescan)
+      for (auto idx : changes)
+        m_queue_around(idx);
+  }
 
-    if (not_opened.size() > 20)
+  // @brief Returns true for open numbered tiles which still have closed
+  // unflagged neighbours.
+  bool m_b_frontier(size_type idx) const {
+    if (!is_number_open(idx))
       return false;
+    for (auto n : m_board.neighbours(idx))
+      if (is_not_flagged_open(n))
+        return true;
+    return false;
+  }
 
-    std::vector<bool> permu_copy;
-    size_type ok_count = 0;
+  // @brief Returns the constraint of open numbered tile %idx.
+  Constraint m_constraint(size_type idx) const noexcept {
+    const auto& tiles = m_board.m_tiles;
+    Constraint constraint{0, static_cast<int>(tiles[idx].value()) -
+                                 m_board.m_flagged_neighbours[idx]};
+    for (unsigned mask = m_board.m_neighbour_masks[idx]; mask != 0;
+         mask &= mask - 1) {
+      const auto dir = bit_scan(mask);
+      const auto& tile = tiles[idx + m_board.m_neighbour_offsets[dir]];
+      if (!(tile.is_open() || tile.is_flagged()))
+        constraint.mask |= 1u << dir;
+    }
+    return constraint;
+  }
 
-    do {
-      for (size_type i = 0; i < not_opened.size(); ++i) {
-        if (flag_bits[i])
-          tiles[not_opened[i]].set_flagged();
-        else
-          tiles[not_opened[i]].set_unflagged();
-      }
-      bool ok_combi = true;
-      for (size_type i = 0; i < not_opened.size(); ++i) {
-        for (auto n : m_board.m_tile_neighbours_bnds(not_opened[i]))
-          if (tiles[n].is_open() && tiles[n].is_number() &&
-              tiles[n].value() != flagged_neighbours_count(n))
-            ok_combi = false;
-      }
-      if (ok_combi) {
-        ++ok_count;
-        if (ok_count > 1) {
-          for (size_type i = 0; i < not_opened.size(); ++i)
-            tiles[not_opened[i]].set_unflagged();
-          return false;
+  // Neighbourhoods of two tiles at most two tiles apart, where they overlap.
+  struct Overlap {
+    // Directions from the first tile to the tiles both have as neighbours.
+    unsigned char first;
+    // Directions from the second tile to the same tiles.
+    unsigned char second;
+  };
+
+  // @brief Returns the overlap of the neighbourhoods of a tile and a tile
+  // %dx, %dy tiles from it. Table of every such pair is generated at compile
+  // time, so pairing up constraints takes a lookup instead of geometry.
+  static Overlap m_overlap(int dx, int dy) noexcept {
+    static constexpr auto table = [] {
+      // Neighbour offsets in the direction order of the board's masks.
+      constexpr int dir_x[MineBoard::TILE_NEIGHBOUR_COUNT] = {-1, 0,  1, -1,
+                                                              1,  -1, 0, 1};
+      constexpr int dir_y[MineBoard::TILE_NEIGHBOUR_COUNT] = {-1, -1, -1, 0,
+                                                              0,  1,  1,  1};
+      std::array<Overlap, 25> overlaps{};
+      for (int y = -2; y <= 2; ++y)
+        for (int x = -2; x <= 2; ++x) {
+          auto& overlap = overlaps[(y + 2) * 5 + x + 2];
+          for (unsigned a = 0; a < MineBoard::TILE_NEIGHBOUR_COUNT; ++a)
+            for (unsigned b = 0; b < MineBoard::TILE_NEIGHBOUR_COUNT; ++b)
+              if (dir_x[a] == x + dir_x[b] && dir_y[a] == y + dir_y[b]) {
+                overlap.first |= 1u << a;
+                overlap.second |= 1u << b;
+              }
         }
-        permu_copy = flag_bits;
-      }
-    } while (std::next_permutation(flag_bits.begin(), flag_bits.end()));
-
-    for (size_type i = 0; i < not_opened.size(); ++i) {
-      if (permu_copy[i])
-        tiles[not_opened[i]].set_flagged();
-      else
-        tiles[not_opened[i]].set_unflagged();
-    }
+      return overlaps;
+    }();
+    return table[(dy + 2) * 5 + dx + 2];
+  }
 
+  // @brief Makes one deduction from the constraint of frontier tile %idx
+  // alone or together with a constraint within two tiles of it. Returns
+  // false if nothing could be deduced.
+  bool m_propagate_at(size_type idx) {
+    Deduction deduction;
+    if (!m_b_find_deduction(idx, deduction))
+      return false;
+    const auto* offsets = m_board.m_neighbour_offsets.data();
+    for (auto n : MineBoard::neighbour_range(deduction.mines_at,
+                                             deduction.mines, offsets))
+      m_board.m_set_flag(n, true);
+    for (auto n : MineBoard::neighbour_range(deduction.safe_at,
+                                             deduction.safe, offsets))
+      m_open_safe(n);
     return true;
   }
 
-  auto b_solve() {
-    while (b_overlap_solve() || b_common_solve() || b_pattern_solve())
-      open_by_flagged();
+  // @brief Finds one deduction %m_propagate_at would make at frontier tile
+  // %idx without making it. Returns false if there is none.
+  bool m_b_find_deduction(size_type idx, Deduction& deduction) const {
+    const auto constraint = m_constraint(idx);
+    const auto unknown = static_cast<int>(bit_count(constraint.mask));
+    if (constraint.mines == 0 || constraint.mines == unknown) {
+      const unsigned char mines = constraint.mines == 0 ? 0 : constraint.mask;
+      deduction = {idx, mines, idx,
+                   static_cast<unsigned char>(constraint.mask & ~mines)};
+      return true;
+    }
 
-    return b_suffle_solve();
+    const auto width = static_cast<int>(m_board.width()),
+               height = static_cast<int>(m_board.height());
+    const auto x = static_cast<int>(idx % m_board.width()),
+               y = static_cast<int>(idx / m_board.width());
+    for (int dy = -2; dy <= 2; ++dy) {
+      if (y + dy < 0 || y + dy >= height)
+        continue;
+      for (int dx = -2; dx <= 2; ++dx) {
+        if (x + dx < 0 || x + dx >= width || (dx == 0 && dy == 0))
+          continue;
+        const auto other_idx =
+            static_cast<size_type>((y + dy) * width + x + dx);
+        if (!is_number_open(other_idx))
+          continue;
+        const auto other = m_constraint(other_idx);
+        const auto overlap = m_overlap(dx, dy);
+        if ((constraint.mask & overlap.first) == 0)
+          continue;
+        // Unknown tiles both see are unknown to both, so the rest of
+        // either mask is what only that constraint sees.
+        const unsigned char only_first = constraint.mask & ~overlap.first,
+                            only_second = other.mask & ~overlap.second;
+        if (m_b_deduce(idx, only_first, constraint.mines, other_idx,
+                       only_second, other.mines, deduction) ||
+            m_b_deduce(other_idx, only_second, other.mines, idx, only_first,
+                       constraint.mines, deduction))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  // @brief Deduces from the constraints of tiles %first and %second, given
+  // the directions to the tiles only each of them sees and their mine
+  // counts. When the tiles only %first sees can hold all the mines that
+  // %first has more than %second, they are all mines and the tiles only
+  // %second sees are safe. Subset, superset and one mine difference patterns
+  // are all special cases of this.
+  static bool m_b_deduce(size_type first, unsigned char only_first,
+                         int first_mines, size_type second,
+                         unsigned char only_second, int second_mines,
+                         Deduction& deduction) {
+    if ((only_first | only_second) == 0 ||
+        first_mines - second_mines != static_cast<int>(bit_count(only_first)))
+      return false;
+    deduction = {first, only_first, second, only_second};
+    return true;
   }
 };
 
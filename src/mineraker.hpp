@@ -2,6 +2,7 @@
 #define MINERAKER_HPP
 
 #include <cstddef> // std::size_t, std::ptrdiff_t
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <iostream>
@@ -54,6 +55,31 @@ template<typename T> void call_once(T (*func)()) {
   is_used.push_back(func);
 }
 
+// @brief Returns the amount of set bits in %word.
+inline size_type bit_count(std::uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_type>(__builtin_popcountll(word));
+#else
+  size_type count = 0;
+  for (; word != 0; word &= word - 1)
+    ++count;
+  return count;
+#endif
+}
+
+// @brief Returns the index of the lowest set bit in %word. %word must not be
+// zero.
+inline size_type bit_scan(std::uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_type>(__builtin_ctzll(word));
+#else
+  size_type idx = 0;
+  for (; (word & 1) == 0; word >>= 1)
+    ++idx;
+  return idx;
+#endif
+}
+
 static constexpr int SCREEN_WIDTH = 640, SCREEN_HEIGHT = 480;
 // Tile input texture dimensions used for clipping individual textures.
 static constexpr int TEXTURE_WIDTH_COUNT = 4, TEXTURE_HEIGHT_COUNT = 3;
@@ -0,0 +1,183 @@
+#ifndef NUMBERKERNEL_HPP
+#define NUMBERKERNEL_HPP
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAKE_NUMBERKERNEL_X86
+#include <immintrin.h>
+#endif
+
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Computes neighbouring mine counts of all tiles at once. Mines are
+ * read from a byte plane padded with a zero border of one tile, so that
+ * every tile has all eight neighbours. Each row's count is the sum of
+ * vertically summed rows shifted left and right, minus the tile itself.
+ * Sums are done 16 or 32 tiles at a time with SSE2 or AVX2 when the CPU
+ * supports them, with a scalar fallback otherwise.
+ */
+class NumberKernel {
+public:
+  enum Kernel {
+    AUTO,
+    SCALAR,
+    SSE2,
+    AVX2,
+  };
+
+  // @brief Returns the fastest kernel supported by the running CPU.
+  static Kernel best() noexcept {
+#ifdef RAKE_NUMBERKERNEL_X86
+    static const Kernel kernel = __builtin_cpu_supports("avx2")
+                                     ? AVX2
+                                     : (__builtin_cpu_supports("sse2")
+                                            ? SSE2
+                                            : SCALAR);
+    return kernel;
+#else
+    return SCALAR;
+#endif
+  }
+
+  // @brief Returns true if %kernel can be run on this CPU.
+  static bool b_supported(Kernel kernel) noexcept {
+    switch (kernel) {
+    case AUTO:
+    case SCALAR:
+      return true;
+#ifdef RAKE_NUMBERKERNEL_X86
+    case SSE2:
+      return __builtin_cpu_supports("sse2");
+    case AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+    }
+  }
+
+  // @brief Writes mine counts of %width * %height tiles to %counts. %mines is
+  // a plane of 0 and 1 bytes with a zero border: its row stride is
+  // %width + 2 and it has %height + 2 rows. %row_sum is scratch space of
+  // %width + 2 bytes.
+  static void count(const unsigned char* mines, size_type width,
+                    size_type height, unsigned char* row_sum,
+                    unsigned char* counts, Kernel kernel = AUTO) noexcept {
+    if (kernel == AUTO || !b_supported(kernel))
+      kernel = best();
+    const auto stride = width + 2;
+    for (size_type y = 0; y < height; ++y) {
+      const auto* up = mines + y * stride;
+      const auto* mid = up + stride;
+      const auto* down = mid + stride;
+      auto* out = counts + y * width;
+      switch (kernel) {
+#ifdef RAKE_NUMBERKERNEL_X86
+      case AVX2:
+        m_row_avx2(up, mid, down, stride, row_sum, out);
+        break;
+      case SSE2:
+        m_row_sse2(up, mid, down, stride, row_sum, out);
+        break;
+#endif
+      default:
+        m_row_scalar(up, mid, down, stride, row_sum, out);
+        break;
+      }
+    }
+  }
+
+private:
+  // @brief Counts a single row. %up, %mid and %down point to the starts of
+  // padded plane rows around it.
+  static void m_row_scalar(const unsigned char* up, const unsigned char* mid,
+                           const unsigned char* down, size_type stride,
+                           unsigned char* row_sum,
+                           unsigned char* out) noexcept {
+    for (size_type x = 0; x < stride; ++x)
+      row_sum[x] = up[x] + mid[x] + down[x];
+    // %out has no border so tile x of the row is column x + 1 of the plane.
+    for (size_type x = 0; x + 2 < stride; ++x)
+      out[x] = row_sum[x] + row_sum[x + 1] + row_sum[x + 2] - mid[x + 1];
+  }
+
+#ifdef RAKE_NUMBERKERNEL_X86
+  __attribute__((target("sse2"))) static void
+  m_row_sse2(const unsigned char* up, const unsigned char* mid,
+             const unsigned char* down, size_type stride,
+             unsigned char* row_sum, unsigned char* out) noexcept {
+    constexpr size_type LANES = 16;
+    size_type x = 0;
+    for (; x + LANES <= stride; x += LANES) {
+      auto sum = _mm_add_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x)),
+          _mm_add_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x)),
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(down + x))));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row_sum + x), sum);
+    }
+    for (; x < stride; ++x)
+      row_sum[x] = up[x] + mid[x] + down[x];
+
+    x = 0;
+    for (; x + 2 + LANES <= stride; x += LANES) {
+      auto left =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_sum + x));
+      auto centre =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_sum + x + 1));
+      auto right =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_sum + x + 2));
+      auto self =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x + 1));
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i*>(out + x),
+          _mm_sub_epi8(_mm_add_epi8(_mm_add_epi8(left, centre), right), self));
+    }
+    for (; x + 2 < stride; ++x)
+      out[x] = row_sum[x] + row_sum[x + 1] + row_sum[x + 2] - mid[x + 1];
+  }
+
+  __attribute__((target("avx2"))) static void
+  m_row_avx2(const unsigned char* up, const unsigned char* mid,
+             const unsigned char* down, size_type stride,
+             unsigned char* row_sum, unsigned char* out) noexcept {
+    constexpr size_type LANES = 32;
+    size_type x = 0;
+    for (; x + LANES <= stride; x += LANES) {
+      auto sum = _mm256_add_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(up + x)),
+          _mm256_add_epi8(
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mid + x)),
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(down + x))));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(row_sum + x), sum);
+    }
+    for (; x < stride; ++x)
+      row_sum[x] = up[x] + mid[x] + down[x];
+
+    x = 0;
+    for (; x + 2 + LANES <= stride; x += LANES) {
+      auto left =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_sum + x));
+      auto centre =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_sum + x + 1));
+      auto right =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_sum + x + 2));
+      auto self =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mid + x + 1));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x),
+                          _mm256_sub_epi8(_mm256_add_epi8(
+                                              _mm256_add_epi8(left, centre),
+                                              right),
+                                          self));
+    }
+    for (; x + 2 < stride; ++x)
+      out[x] = row_sum[x] + row_sum[x + 1] + row_sum[x + 2] - mid[x + 1];
+  }
+#endif
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Counter-based random number generator Philox4x32-10. Output is a
+ * pure function of the key and a 128-bit counter, so any position of any
+ * stream can be computed directly without generating the values before it.
+ * Key is formed from the seed and the upper half of the counter from the
+ * stream index; the lower half counts generated blocks. Streams with
+ * different indexes never overlap.
+ * @note Satisfies UniformRandomBitGenerator so it can be used with standard
+ * library distributions, but %below should be preferred for reproducible
+ * results across standard library implementations.
+ */
+class Philox4x32 {
+public:
+  using this_type = Philox4x32;
+  using result_type = std::uint64_t;
+  using key_type = std::array<std::uint32_t, 2>;
+  using counter_type = std::array<std::uint32_t, 4>;
+
+  static constexpr unsigned ROUNDS = 10;
+
+private:
+  static constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  static constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+  key_type m_key;
+  counter_type m_counter;
+  // Latest generated block and how many 64-bit values of it are used.
+  counter_type m_block;
+  unsigned m_used;
+
+public:
+  // @brief Constructs generator for stream %stream of %seed positioned at its
+  // start.
+  explicit Philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0)
+      : m_key{static_cast<std::uint32_t>(seed),
+              static_cast<std::uint32_t>(seed >> 32)},
+        m_counter{0, 0, static_cast<std::uint32_t>(stream),
+                  static_cast<std::uint32_t>(stream >> 32)},
+        m_block(), m_used(2) {}
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  // @brief Returns next 64-bit value of the stream.
+  result_type operator()() noexcept {
+    if (m_used == 2) {
+      m_block = block(m_counter, m_key);
+      m_increment();
+      m_used = 0;
+    }
+    auto lo = m_block[2 * m_used], hi = m_block[2 * m_used + 1];
+    ++m_used;
+    return (static_cast<result_type>(hi) << 32) | lo;
+  }
+
+  // @brief Returns uniformly distributed value in range [0, %bound). Rejects
+  // values from the incomplete last interval so the result isn't biased
+  // towards small values. %bound must not be zero.
+  result_type below(result_type bound) noexcept {
+    // Equals 2^64 % bound.
+    const auto threshold = (0 - bound) % bound;
+    for (;;) {
+      auto value = (*this)();
+      if (value >= threshold)
+        return value % bound;
+    }
+  }
+
+  // @brief Positions generator at %position:th 64-bit value of its stream.
+  void seek(std::uint64_t position) noexcept {
+    const auto block_idx = position / 2;
+    m_counter[0] = static_cast<std::uint32_t>(block_idx);
+    m_counter[1] = static_cast<std::uint32_t>(block_idx >> 32);
+    m_used = 2;
+    if (position % 2 != 0)
+      (*this)();
+  }
+
+  // @brief Computes a single Philox4x32-10 block for %counter and %key.
+  static counter_type block(counter_type counter, key_type key) noexcept {
+    for (unsigned round = 0; round < ROUNDS; ++round) {
+      if (round != 0) {
+        key[0] += W0;
+        key[1] += W1;
+      }
+      const auto p0 = static_cast<std::uint64_t>(M0) * counter[0],
+                 p1 = static_cast<std::uint64_t>(M1) * counter[2];
+      counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+                 static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+                 static_cast<std::uint32_t>(p0)};
+    }
+    return counter;
+  }
+
+private:
+  // @brief Advances the block counter inside the stream.
+  void m_increment() noexcept {
+    if (++m_counter[0] == 0)
+      ++m_counter[1];
+  }
+};
+
+} // namespace rake
+
+#endif
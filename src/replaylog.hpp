@@ -0,0 +1,156 @@
+#ifndef REPLAYLOG_HPP
+#define REPLAYLOG_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "boardtile.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Append-only binary log of games played on a MineBoard. Log starts
+ * with %MAGIC and is followed by records, each starting with a varint of
+ * its event kind and tile index delta, and a varint of microseconds passed
+ * since the previous record. Index deltas are zigzag encoded differences to
+ * the previous action's tile, so nearby moves take a byte or two.
+ *   BOARD: new game, followed by varints of width, height, mine count, seed
+ *          and board index.
+ *   LAYOUT: mines laid, followed by a bit per tile. Logged before the first
+ *           move that opens a tile.
+ *   OPEN, CHORD, FLAG: player actions on a tile.
+ * @note Layouts are logged, so replaying doesn't depend on the mine
+ * generator or on how the board got its mines.
+ */
+class ReplayLog {
+public:
+  using this_type = ReplayLog;
+  using byte_type = unsigned char;
+  using clock_type = std::chrono::steady_clock;
+
+  enum Event : unsigned char {
+    BOARD,
+    LAYOUT,
+    OPEN,
+    CHORD,
+    FLAG,
+  };
+
+  static constexpr unsigned EVENT_BITS = 3;
+  static constexpr byte_type MAGIC[8] = {'R', 'A', 'K', 'E', 'L', 'O', 'G', 1};
+
+private:
+  std::vector<byte_type> m_bytes;
+  // Amount of bytes already written by %flush.
+  size_type m_flushed;
+  size_type m_previous_idx;
+  clock_type::time_point m_previous_time;
+
+public:
+  ReplayLog() { clear(); }
+  ~ReplayLog() noexcept {}
+
+  // @brief Empties the log to only its header.
+  void clear() {
+    m_bytes.assign(std::begin(MAGIC), std::end(MAGIC));
+    m_flushed = 0;
+    m_previous_idx = 0;
+    m_previous_time = clock_type::now();
+  }
+
+  // @brief Returns all bytes of the log.
+  const std::vector<byte_type>& bytes() const noexcept { return m_bytes; }
+
+  // @brief Writes bytes appended since the previous flush to %out. Returns
+  // the amount of bytes written.
+  size_type flush(std::ostream& out) {
+    const auto count = m_bytes.size() - m_flushed;
+    out.write(reinterpret_cast<const char*>(m_bytes.data() + m_flushed),
+              count);
+    m_flushed = m_bytes.size();
+    return count;
+  }
+
+  // @brief Logs start of a new game.
+  void board(size_type width, size_type height, size_type mine_count,
+             std::uint64_t seed, std::uint64_t board_index) {
+    m_previous_idx = 0;
+    m_record(BOARD, 0);
+    m_put_varint(width);
+    m_put_varint(height);
+    m_put_varint(mine_count);
+    m_put_varint(seed);
+    m_put_varint(board_index);
+  }
+
+  // @brief Logs mines of %count tiles starting from %tiles.
+  void layout(const BoardTile* tiles, size_type count) {
+    m_record(LAYOUT, 0);
+    for (size_type i = 0; i < count; i += 8) {
+      byte_type byte = 0;
+      for (size_type bit = 0; bit < 8 && i + bit < count; ++bit)
+        byte |= static_cast<byte_type>(tiles[i + bit].is_mine()) << bit;
+      m_bytes.emplace_back(byte);
+    }
+  }
+
+  // @brief Logs player action %event on tile %idx.
+  void action(Event event, size_type idx) {
+    const auto delta = static_cast<std::int64_t>(idx - m_previous_idx);
+    m_previous_idx = idx;
+    m_record(event, zigzag(delta));
+  }
+
+  // @brief Maps signed %value to unsigned so that small magnitudes stay
+  // small.
+  static constexpr std::uint64_t zigzag(std::int64_t value) noexcept {
+    return (static_cast<std::uint64_t>(value) << 1) ^
+           static_cast<std::uint64_t>(value >> 63);
+  }
+
+  static constexpr std::int64_t unzigzag(std::uint64_t value) noexcept {
+    return static_cast<std::int64_t>(value >> 1) ^
+           -static_cast<std::int64_t>(value & 1);
+  }
+
+  // @brief Reads a varint from [%pos, %end) and advances %pos past it.
+  // Returns false if the varint is truncated or too long.
+  static bool read_varint(const byte_type*& pos, const byte_type* end,
+                          std::uint64_t& value) noexcept {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos != end; shift += 7) {
+      const auto byte = *pos++;
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  void m_record(Event event, std::uint64_t payload) {
+    const auto now = clock_type::now();
+    const auto micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - m_previous_time)
+            .count();
+    m_previous_time = now;
+    m_put_varint((payload << EVENT_BITS) | event);
+    m_put_varint(static_cast<std::uint64_t>(micros));
+  }
+
+  void m_put_varint(std::uint64_t value) {
+    while (value >= 0x80) {
+      m_bytes.emplace_back(static_cast<byte_type>(value | 0x80));
+      value >>= 7;
+    }
+    m_bytes.emplace_back(static_cast<byte_type>(value));
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef REPLAYPLAYER_HPP
+#define REPLAYPLAYER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "mineboard.hpp"
+#include "mineraker.hpp"
+#include "replaylog.hpp"
+
+namespace rake {
+
+/**
+ * @brief Replays a %ReplayLog onto a MineBoard without the UI. Log bytes are
+ * read in place and decoded one record at a time.
+ */
+class ReplayPlayer {
+public:
+  using this_type = ReplayPlayer;
+  using byte_type = ReplayLog::byte_type;
+
+  // Largest board a log may describe. Bounds the memory a broken log can
+  // make the player allocate.
+  static constexpr size_type MAX_TILE_COUNT = size_type{1} << 24;
+
+  // Single decoded record.
+  struct Step {
+    ReplayLog::Event event;
+    // Tile of an action. Zero for other events.
+    size_type idx;
+    // Microseconds since the start of the log.
+    std::uint64_t time;
+  };
+
+private:
+  const byte_type* m_pos;
+  const byte_type* m_end;
+  bool m_b_error;
+  size_type m_previous_idx;
+  std::uint64_t m_time;
+  // Scratch space for decoded layouts.
+  std::vector<bool> m_mines;
+
+public:
+  ReplayPlayer(const byte_type* data, size_type size)
+      : m_pos(data), m_end(data + size), m_b_error(false), m_previous_idx(0),
+        m_time(0) {
+    const auto magic_size = sizeof(ReplayLog::MAGIC);
+    if (size < magic_size ||
+        !std::equal(data, data + magic_size, ReplayLog::MAGIC))
+      m_b_error = true;
+    else
+      m_pos += magic_size;
+  }
+  explicit ReplayPlayer(const std::vector<byte_type>& bytes)
+      : ReplayPlayer(bytes.data(), bytes.size()) {}
+  explicit ReplayPlayer(std::string_view bytes)
+      : ReplayPlayer(reinterpret_cast<const byte_type*>(bytes.data()),
+                     bytes.size()) {}
+
+  // @brief Returns true if the log was found broken.
+  bool b_error() const noexcept { return m_b_error; }
+
+  // @brief Returns true when every record has been replayed or the log was
+  // found broken.
+  bool b_done() const noexcept { return m_b_error || m_pos == m_end; }
+
+  // @brief Applies the next record to %board and stores it to %step if given.
+  // Returns false at the end of the log or if the log is broken.
+  bool next(MineBoard& board, Step* step = nullptr) {
+    if (b_done())
+      return false;
+    std::uint64_t head = 0, micros = 0;
+    if (!ReplayLog::read_varint(m_pos, m_end, head) ||
+        !ReplayLog::read_varint(m_pos, m_end, micros))
+      return m_fail();
+    m_time += micros;
+    const auto event = static_cast<ReplayLog::Event>(
+        head & ((1u << ReplayLog::EVENT_BITS) - 1));
+    const auto payload = head >> ReplayLog::EVENT_BITS;
+    size_type idx = 0;
+
+    switch (event) {
+    case ReplayLog::BOARD: {
+      std::uint64_t fields[5];
+      for (auto& field : fields)
+        if (!ReplayLog::read_varint(m_pos, m_end, field))
+          return m_fail();
+      // Dimensions are untrusted, so their product is checked by division.
+      if (fields[0] == 0 || fields[1] == 0 ||
+          fields[0] > MAX_TILE_COUNT / fields[1])
+        return m_fail();
+      board.init(fields[0], fields[1], fields[3], fields[2], fields[4]);
+      m_previous_idx = 0;
+      break;
+    }
+    case ReplayLog::LAYOUT: {
+      const auto count = board.tile_count();
+      if (static_cast<size_type>(m_end - m_pos) < (count + 7) / 8)
+        return m_fail();
+      m_mines.resize(count);
+      for (size_type i = 0; i < count; ++i)
+        m_mines[i] = (m_pos[i / 8] >> (i % 8)) & 1;
+      m_pos += (count + 7) / 8;
+      board.lay_mines(m_mines);
+      break;
+    }
+    case ReplayLog::OPEN:
+    case ReplayLog::CHORD:
+    case ReplayLog::FLAG:
+      idx = m_previous_idx + ReplayLog::unzigzag(payload);
+      m_previous_idx = idx;
+      if (event == ReplayLog::FLAG)
+        board.flag_tile(idx);
+      else
+        board.open_tile(idx);
+      break;
+    default:
+      return m_fail();
+    }
+    if (step != nullptr)
+      *step = {event, idx, m_time};
+    return true;
+  }
+
+  // @brief Applies every remaining record to %board. Returns the amount of
+  // records applied.
+  size_type play(MineBoard& board) {
+    size_type count = 0;
+    while (next(board))
+      ++count;
+    return count;
+  }
+
+private:
+  bool m_fail() noexcept {
+    m_b_error = true;
+    return false;
+  }
+};
+
+} // namespace rake
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef SOLVEREXECUTOR_HPP
+#define SOLVEREXECUTOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "componentcache.hpp"
+#include "mineboard.hpp"
+#include "mineboardsolver.hpp"
+#include "mineraker.hpp"
+
+namespace rake {
+
+/**
+ * @brief Runs solver jobs on background threads so that the thread rendering
+ * frames never waits for them. Each job works on its own copy of the board
+ * taken when it is submitted, and its completion is called with the board
+ * the job left behind once the owner calls %complete, typically at a frame
+ * boundary. Completions thus run on the owner's thread and may touch the
+ * live board.
+ * @note Live board may have changed while a job ran. Completions decide
+ * whether the result still applies.
+ */
+class SolverExecutor {
+public:
+  using this_type = SolverExecutor;
+  // Solving done on a copy of the board with a solver of that copy.
+  using job_type = std::function<void(MineBoard&, MineBoardSolver&)>;
+  // Receives the board a job left behind.
+  using completion_type = std::function<void(MineBoard&)>;
+
+private:
+  struct Job {
+    // Board is held by pointer so it stays put while a solver refers to it.
+    std::unique_ptr<MineBoard> board;
+    job_type job;
+    completion_type completion;
+  };
+
+  std::mutex m_mutex;
+  // Signals workers that a job was submitted or that they should stop.
+  std::condition_variable m_cv;
+  bool m_b_stopped;
+  std::deque<Job> m_jobs;
+  // Finished jobs waiting for %complete.
+  std::deque<Job> m_done;
+  // Jobs submitted but not yet completed.
+  size_type m_pending;
+  // Enumerated frontier components, shared by the workers' solvers.
+  ComponentCache m_cache;
+  std::vector<std::thread> m_workers;
+
+public:
+  // @brief Constructs executor running jobs on %thread_count threads.
+  explicit SolverExecutor(unsigned thread_count = 1)
+      : m_b_stopped(false), m_pending(0) {
+    for (unsigned w = 0; w < thread_count; ++w)
+      m_workers.emplace_back([this] { m_work(); });
+  }
+  SolverExecutor(const this_type&) = delete;
+  SolverExecutor(this_type&&) = delete;
+  ~SolverExecutor() noexcept { stop(); }
+
+  // @brief Queues %job to run on a copy of %snapshot. %completion is called
+  // with the copy by the first %complete after the job has finished. Jobs
+  // submitted after %stop are dropped.
+  void submit(const MineBoard& snapshot, job_type job,
+              completion_type completion) {
+    auto board = std::make_unique<MineBoard>(snapshot);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_b_stopped)
+        return;
+      m_jobs.push_back({std::move(board), std::move(job),
+                        std::move(completion)});
+      ++m_pending;
+    }
+    m_cv.notify_one();
+  }
+
+  // @brief Calls the completions of finished jobs on the calling thread in
+  // the order the jobs finished. Returns the amount of completed jobs.
+  size_type complete() {
+    std::deque<Job> done;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      done.swap(m_done);
+      m_pending -= done.size();
+    }
+    for (auto& job : done)
+      if (job.completion)
+        job.completion(*job.board);
+    return done.size();
+  }
+
+  // @brief Returns the amount of jobs submitted but not yet completed.
+  size_type pending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+  }
+
+  // @brief Stops and joins the workers. Jobs not yet started are dropped.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_b_stopped = true;
+      m_pending -= m_jobs.size();
+      m_jobs.clear();
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers)
+      if (worker.joinable())
+        worker.join();
+  }
+
+private:
+  // @brief Runs queued jobs until stopped.
+  void m_work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_cv.wait(lock, [this] { return m_b_stopped || !m_jobs.empty(); });
+      if (m_b_stopped)
+        return;
+      auto job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      lock.unlock();
+      {
+        // Solver unsubscribes from the board before the board is handed
+        // over.
+        MineBoardSolver solver(*job.board);
+        solver.cache(&m_cache);
+        job.job(*job.board, solver);
+      }
+      lock.lock();
+      m_done.emplace_back(std::move(job));
+    }
+  }
+};
+
+} // namespace rake
+
+#endif
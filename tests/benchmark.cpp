@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "../src/bitboard.hpp"
+#include "../src/boardcorpus.hpp"
+#include "../src/boardsearch.hpp"
+#include "../src/componentcache.hpp"
+#include "../src/mineboard.hpp"
+#include "../src/mineboardsolver.hpp"
+#include "../src/mineraker.hpp"
+#include "../src/numberkernel.hpp"
+#include "../src/replayplayer.hpp"
+#include "../src/solverexecutor.hpp"
+
+using namespace rake;
+
+// @brief Returns the best wall time of %runs calls to %func in milliseconds.
+double time_ms(const std::function<void()>& func, int runs = 5) {
+  double best = 0.0;
+  for (int i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+// Sink for benchmark results so the compiler can't optimize the work away.
+volatile size_type g_sink = 0;
+
+void bench_neighbours(size_type width, size_type height) {
+  MineBoard mb;
+  mb.init(width, height, 0, 0);
+
+  auto allocating = time_ms([&] {
+    size_type sum = 0;
+    for (size_type i = 0; i < mb.tile_count(); ++i)
+      for (auto n : mb.m_tile_neighbours_bnds(i))
+        sum += n;
+    g_sink = sum;
+  });
+  auto ranged = time_ms([&] {
+    size_type sum = 0;
+    for (size_type i = 0; i < mb.tile_count(); ++i)
+      for (auto n : mb.neighbours(i))
+        sum += n;
+    g_sink = sum;
+  });
+  std::printf("neighbours %zux%zu: vector %.3f ms, range %.3f ms (%.1fx)\n",
+              width, height, allocating, ranged, allocating / ranged);
+}
+
+void bench_flood_open(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  size_type opened = 0;
+  auto elapsed = time_ms([&] {
+    mb.init(width, height, 0, mines);
+    mb.open_tile(mb.tile_count() / 2);
+    opened = mb.open_tiles_count();
+  });
+  std::printf("first click %zux%zu/%zu: %.3f ms, %zu tiles opened\n", width,
+              height, mines, elapsed, opened);
+}
+
+void bench_set_mines(size_type width, size_type height) {
+  MineBoard mb;
+  for (auto percent : {10, 25, 50, 80, 95}) {
+    const auto mines = width * height * percent / 100;
+    auto elapsed = time_ms([&] {
+      mb.init(width, height, 0, mines);
+      mb.m_set_mines(mines, 0);
+    });
+    std::printf("mines %zux%zu at %d%%: %.3f ms\n", width, height, percent,
+                elapsed);
+  }
+}
+
+void bench_numbering(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  mb.init(width, height, 0, mines);
+  mb.m_set_mines(mines, 0);
+  std::printf("numbering %zux%zu/%zu:", width, height, mines);
+  for (auto kernel : {NumberKernel::SCALAR, NumberKernel::SSE2,
+                      NumberKernel::AVX2}) {
+    if (!NumberKernel::b_supported(kernel))
+      continue;
+    auto elapsed = time_ms([&] { mb.m_set_numbered_tiles(kernel); });
+    std::printf(" %s %.3f ms",
+                kernel == NumberKernel::SCALAR
+                    ? "scalar"
+                    : (kernel == NumberKernel::SSE2 ? "sse2" : "avx2"),
+                elapsed);
+  }
+  std::printf("\n");
+}
+
+// @brief Times full-board scans tile by tile on the board against a word at
+// a time on its bit planes: counting mines and finding the unknown tiles
+// next to open numbered ones, as building the solver's frontier does.
+void bench_bitboard(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  mb.init(width, height, 0, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  const BitBoard bb(mb);
+
+  size_type byte_count = 0, plane_count = 0;
+  const auto byte_mines = time_ms([&] {
+    byte_count = 0;
+    for (size_type i = 0; i < mb.tile_count(); ++i)
+      byte_count += mb.m_tiles[i].is_mine();
+  });
+  const auto plane_mines = time_ms([&] { plane_count = bb.mine_count(); });
+
+  size_type byte_cells = 0, plane_cells = 0;
+  const auto byte_frontier = time_ms([&] {
+    byte_cells = 0;
+    for (size_type i = 0; i < mb.tile_count(); ++i) {
+      const auto& tile = mb.m_tiles[i];
+      if (tile.is_open() || tile.is_flagged())
+        continue;
+      bool b_constrained = false;
+      for (auto n : mb.neighbours(i))
+        b_constrained |= mb.m_tiles[n].is_open() && mb.m_tiles[n].is_number();
+      byte_cells += b_constrained;
+    }
+  });
+  BitBoard::plane_type unknown, open_numbers, adjacent;
+  const auto plane_frontier = time_ms([&] {
+    bb.unknown(unknown);
+    bb.numbers(open_numbers);
+    for (size_type w = 0; w < unknown.size(); ++w)
+      open_numbers[w] &= bb.open()[w];
+    bb.adjacent(open_numbers, adjacent);
+    plane_cells = 0;
+    for (size_type w = 0; w < unknown.size(); ++w)
+      plane_cells += bit_count(unknown[w] & adjacent[w]);
+  });
+  g_sink = byte_count + plane_count + byte_cells + plane_cells;
+  std::printf("bitboard %zux%zu/%zu: mines %.3f ms bytes, %.3f ms planes, "
+              "frontier %.3f ms bytes, %.3f ms planes%s\n",
+              width, height, mines, byte_mines, plane_mines, byte_frontier,
+              plane_frontier,
+              byte_count == plane_count && byte_cells == plane_cells
+                  ? ""
+                  : " MISMATCH");
+}
+
+void bench_find_solvable(size_type width, size_type height, size_type mines) {
+  std::vector<unsigned> thread_counts{1};
+  if (std::thread::hardware_concurrency() > 1)
+    thread_counts.push_back(std::thread::hardware_concurrency());
+  for (auto threads : thread_counts) {
+    BoardSearch search(threads);
+    size_type attempts = 0, seeds = 0;
+    auto elapsed = time_ms(
+        [&] {
+          for (BoardSearch::seed_type seed = 0; seed < 10; ++seed, ++seeds)
+            attempts += search.find(width, height, mines,
+                                    width * height / 2, seed)
+                            .attempts;
+        },
+        1);
+    std::printf("solvable %zux%zu/%zu with %u threads: %.3f ms per board, "
+                "%.1f attempts\n",
+                width, height, mines, threads, elapsed / seeds,
+                static_cast<double>(attempts) / seeds);
+  }
+}
+
+void bench_solve(size_type width, size_type height, size_type mines) {
+  MineBoard start;
+  start.init(width, height, 0, mines);
+  start.open_tile(start.tile_count() / 2);
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  // Repeats propagation over the whole board until it stops changing it.
+  auto scanning = time_ms(
+      [&] {
+        mb = start;
+        while (solver.b_constraint_solve())
+          ;
+      },
+      1);
+  const auto scanned = mb.open_tiles_count();
+  auto worklist = time_ms(
+      [&] {
+        mb = start;
+        solver.b_solve();
+      },
+      1);
+  std::printf("solve %zux%zu/%zu: full scans %.3f ms, %zu tiles opened, "
+              "frontier %.3f ms, %zu tiles opened\n",
+              width, height, mines, scanning, scanned, worklist,
+              mb.open_tiles_count());
+}
+
+void bench_probabilities(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  mb.init(width, height, 0, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  solver.b_solve();
+  std::vector<double> probabilities;
+  bool b_computed = false;
+  auto elapsed = time_ms(
+      [&] { b_computed = solver.mine_probabilities(probabilities); });
+  std::printf("probabilities %zux%zu/%zu: %.3f ms%s\n", width, height, mines,
+              elapsed, b_computed ? "" : ", gave up");
+}
+
+// @brief Times probabilities of a board left after a single propagation pass,
+// whose frontier has long components, with one thread and with every thread.
+void bench_enumeration(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  mb.init(width, height, 0, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  solver.b_constraint_solve();
+  std::vector<double> probabilities;
+  auto single = time_ms([&] { solver.mine_probabilities(probabilities); });
+  solver.thread_count(0);
+  auto threaded = time_ms([&] { solver.mine_probabilities(probabilities); });
+  // Later calls reuse the threads started by the first one.
+  constexpr int REPEATS = 20;
+  auto repeated = time_ms([&] {
+    for (int r = 0; r < REPEATS; ++r)
+      solver.mine_probabilities(probabilities);
+  });
+  std::printf("enumeration %zux%zu/%zu: 1 thread %.3f ms, %u threads %.3f ms, "
+              "%.3f ms repeated\n",
+              width, height, mines, single, solver.thread_count(), threaded,
+              repeated / REPEATS);
+}
+
+// @brief Times elimination against enumeration on a board left after a
+// single propagation pass.
+void bench_elimination(size_type width, size_type height, size_type mines) {
+  MineBoard start;
+  start.init(width, height, 0, mines);
+  start.open_tile(start.tile_count() / 2);
+  MineBoardSolver(start).b_constraint_solve();
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  auto eliminating = time_ms(
+      [&] {
+        mb = start;
+        solver.b_elimination_solve();
+      },
+      1);
+  const auto eliminated = mb.open_tiles_count();
+  auto enumerating = time_ms(
+      [&] {
+        mb = start;
+        solver.b_enumerate_solve();
+      },
+      1);
+  std::printf("deduction %zux%zu/%zu: elimination %.3f ms, %zu tiles opened, "
+              "enumeration %.3f ms, %zu tiles opened\n",
+              width, height, mines, eliminating, eliminated, enumerating,
+              mb.open_tiles_count());
+}
+
+// @brief Times enumeration of a board left after a single propagation pass
+// without and with the SAT backend, which decides the components that are
+// too large to enumerate.
+void bench_sat_backend(size_type width, size_type height, size_type mines) {
+  MineBoard start;
+  start.init(width, height, 0, mines);
+  start.open_tile(start.tile_count() / 2);
+  MineBoardSolver(start).b_constraint_solve();
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  size_type opened[2] = {};
+  double elapsed[2] = {};
+  for (int b_sat = 0; b_sat < 2; ++b_sat) {
+    solver.sat_backend(b_sat);
+    elapsed[b_sat] = time_ms(
+        [&] {
+          mb = start;
+          solver.b_enumerate_solve();
+        },
+        1);
+    opened[b_sat] = mb.open_tiles_count();
+  }
+  std::printf("sat backend %zux%zu/%zu: off %.3f ms, %zu tiles opened, "
+              "on %.3f ms, %zu tiles opened\n",
+              width, height, mines, elapsed[0], opened[0], elapsed[1],
+              opened[1]);
+}
+
+// @brief Times hints on a board where deductions have run out, so hints
+// escalate to probabilities, with %budget_ms and without a budget. Slowest
+// call counts, as the budget bounds how long a player waits for a hint.
+void bench_hint(size_type width, size_type height, size_type mines,
+                int budget_ms) {
+  MineBoard mb;
+  mb.init(width, height, 0, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  MineBoardSolver solver(mb);
+  solver.b_solve();
+  const MineBoardSolver::clock_type::duration budgets[2] = {
+      std::chrono::milliseconds(budget_ms),
+      MineBoardSolver::clock_type::duration::max()};
+  double slowest[2] = {};
+  int kinds[2] = {};
+  for (int b = 0; b < 2; ++b)
+    for (int run = 0; run < 5; ++run) {
+      MineBoardSolver::Hint hint;
+      const auto elapsed = time_ms([&] { hint = solver.hint(budgets[b]); }, 1);
+      slowest[b] = std::max(slowest[b], elapsed);
+      kinds[b] = hint.kind;
+    }
+  std::printf("hint %zux%zu/%zu: %d ms budget %.3f ms, kind %d, "
+              "unbounded %.3f ms, kind %d\n",
+              width, height, mines, budget_ms, slowest[0], kinds[0],
+              slowest[1], kinds[1]);
+}
+
+// @brief Times the frame thread's share of a solve: solving inline against
+// submitting it to an executor and later applying the result.
+void bench_executor(size_type width, size_type height, size_type mines) {
+  MineBoard start;
+  start.init(width, height, 0, mines);
+  start.open_tile(start.tile_count() / 2);
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  const auto inline_ms = time_ms([&] {
+    mb = start;
+    solver.b_solve();
+  });
+  SolverExecutor executor;
+  double submit_ms = 0.0, apply_ms = 0.0;
+  for (int run = 0; run < 5; ++run) {
+    submit_ms += time_ms(
+        [&] {
+          executor.submit(
+              start,
+              [](MineBoard&, MineBoardSolver& solver) { solver.b_solve(); },
+              [&](MineBoard& result) { mb = std::move(result); });
+        },
+        1);
+    while (executor.pending() != 0) {
+      apply_ms += time_ms([&] { executor.complete(); }, 1);
+      std::this_thread::yield();
+    }
+  }
+  std::printf("executor %zux%zu/%zu: inline %.3f ms, submit %.3f ms, "
+              "apply %.3f ms, %zu tiles opened\n",
+              width, height, mines, inline_ms, submit_ms / 5, apply_ms / 5,
+              mb.open_tiles_count());
+}
+
+// @brief Times solving %boards boards without and with a component cache
+// shared by all of them, as bulk simulations do.
+void bench_component_cache(size_type width, size_type height,
+                           size_type mines, size_type boards) {
+  MineBoard mb;
+  MineBoardSolver solver(mb);
+  ComponentCache cache;
+  std::vector<double> probabilities;
+  // Whole solves, and enumeration alone after a propagation pass.
+  double solving[2] = {}, enumerating[2] = {};
+  for (int b_cached = 0; b_cached < 2; ++b_cached) {
+    solver.cache(b_cached ? &cache : nullptr);
+    cache.clear();
+    solving[b_cached] = time_ms(
+        [&] {
+          for (size_type k = 0; k < boards; ++k) {
+            mb.init(width, height, 0, mines, k);
+            mb.open_tile(mb.tile_count() / 2);
+            solver.b_solve();
+          }
+        },
+        1);
+    cache.clear();
+    for (size_type k = 0; k < boards; ++k) {
+      mb.init(width, height, 0, mines, k);
+      mb.open_tile(mb.tile_count() / 2);
+      solver.b_constraint_solve();
+      enumerating[b_cached] += time_ms(
+          [&] { solver.mine_probabilities(probabilities); }, 1);
+    }
+  }
+  const auto lookups = cache.hits() + cache.misses();
+  std::printf("component cache %zux%zu/%zu, %zu boards: solve off %.3f ms, "
+              "on %.3f ms, enumeration off %.3f ms, on %.3f ms, "
+              "%.1f%% hits\n",
+              width, height, mines, boards, solving[0], solving[1],
+              enumerating[0], enumerating[1],
+              lookups != 0 ? 100.0 * cache.hits() / lookups : 0.0);
+}
+
+void bench_corpus(size_type width, size_type height, size_type mines,
+                  size_type boards) {
+  const char* path = "benchmark_corpus.bin";
+  MineBoard mb;
+  auto writing = time_ms(
+      [&] {
+        CorpusWriter writer(path);
+        for (size_type k = 0; k < boards; ++k) {
+          mb.init(width, height, 0, mines, k);
+          mb.m_set_mines(mines, 0);
+          writer.write(mb);
+        }
+      },
+      1);
+  CorpusReader reader(path);
+  auto reading = time_ms([&] {
+    size_type sum = 0;
+    for (size_type k = 0; k < reader.size(); ++k)
+      sum += reader.view((k * 7919) % reader.size()).mine_words()[0];
+    g_sink = sum;
+  });
+  auto regenerating = time_ms(
+      [&] {
+        for (size_type k = 0; k < boards; ++k) {
+          mb.init(width, height, 0, mines, k);
+          mb.m_set_mines(mines, 0);
+        }
+      },
+      1);
+  std::printf("corpus %zux%zu/%zu of %zu boards: write %.3f ms, random "
+              "reads %.3f ms, regenerating %.3f ms\n",
+              width, height, mines, boards, writing, reading, regenerating);
+  std::remove(path);
+}
+
+void bench_replay(size_type width, size_type height, size_type mines,
+                  size_type games) {
+  ReplayLog log;
+  MineBoard mb;
+  mb.record(&log);
+  size_type actions = 0;
+  for (size_type g = 0; g < games; ++g) {
+    mb.init(width, height, g, mines);
+    // Seed changed after the BOARD record, so replay must not regenerate
+    // mines from the logged seed.
+    mb.seed(g + games);
+    // Opens tiles in a fixed pseudo-random order until the game ends.
+    for (size_type i = g; mb.state() == MineBoard::State::FIRST_MOVE ||
+                          mb.state() == MineBoard::State::NEXT_MOVE;
+         ++actions)
+      mb.open_tile((i = i * 1103515245 + 12345) % mb.tile_count());
+  }
+  MineBoard replayed;
+  auto elapsed = time_ms([&] {
+    ReplayPlayer player(log.bytes());
+    g_sink = player.play(replayed);
+  });
+  // Replayed board ends up as the last recorded game.
+  bool b_equal = replayed.state() == mb.state() &&
+                 replayed.tile_count() == mb.tile_count();
+  for (size_type i = 0; b_equal && i < mb.tile_count(); ++i)
+    b_equal = replayed.m_tiles[i].is_mine() == mb.m_tiles[i].is_mine() &&
+              replayed.m_tiles[i].is_open() == mb.m_tiles[i].is_open() &&
+              replayed.m_tiles[i].is_flagged() == mb.m_tiles[i].is_flagged();
+  std::printf("replay %zux%zu/%zu of %zu games: %zu actions in %zu bytes, "
+              "%.3f ms%s\n",
+              width, height, mines, games, actions, log.bytes().size(),
+              elapsed, b_equal ? "" : " MISMATCH");
+}
+
+int main() {
+  bench_neighbours(30, 16);
+  bench_neighbours(2000, 2000);
+  bench_flood_open(30, 16, 99);
+  bench_flood_open(2000, 2000, 40000);
+  bench_set_mines(30, 16);
+  bench_set_mines(1000, 1000);
+  bench_numbering(30, 16, 99);
+  bench_numbering(2000, 2000, 1600000);
+  bench_bitboard(2000, 2000, 400000);
+  bench_find_solvable(16, 16, 40);
+  bench_find_solvable(30, 16, 99);
+  bench_solve(30, 16, 99);
+  bench_solve(500, 500, 30000);
+  bench_probabilities(30, 16, 99);
+  bench_probabilities(500, 500, 51562);
+  bench_enumeration(100, 100, 1200);
+  bench_elimination(500, 500, 30000);
+  bench_sat_backend(500, 500, 30000);
+  bench_component_cache(30, 16, 99, 10000);
+  bench_hint(500, 500, 30000, 2);
+  bench_executor(500, 500, 30000);
+  bench_corpus(30, 16, 99, 100000);
+  bench_replay(30, 16, 99, 10000);
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <vector>
+
+#include "../src/bitboard.hpp"
+#include "../src/mineboard.hpp"
+#include "../src/mineraker.hpp"
+
+using namespace rake;
+
+// Amount of failed checks.
+int g_failures = 0;
+
+void check(bool b_passed, const char* what, size_type width,
+           size_type height) {
+  if (!b_passed) {
+    ++g_failures;
+    std::printf("FAILED %s on %zux%zu\n", what, width, height);
+  }
+}
+
+// @brief Returns true if tile %idx of %planes is set on %plane.
+bool b_bit(const BitBoard::plane_type& plane, size_type idx) {
+  return (plane[idx / BitBoard::WORD_BITS] >> (idx % BitBoard::WORD_BITS)) &
+         1;
+}
+
+// @brief Checks the planes of a board with some tiles opened and flagged
+// against the board's own tiles.
+void test_board(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  mb.init(width, height, 7, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  for (size_type i = 0; i < mb.tile_count(); i += 7)
+    if (!mb.m_tiles[i].is_open())
+      mb.flag_tile(i);
+  const BitBoard bb(mb);
+  BitBoard::plane_type numbers;
+  bb.numbers(numbers);
+
+  bool b_tiles = true;
+  size_type next = bb.next_mine(0);
+  for (size_type i = 0; i < mb.tile_count(); ++i) {
+    const auto& tile = mb.m_tiles[i];
+    b_tiles &= bb.is_mine(i) == tile.is_mine() &&
+               bb.is_open(i) == tile.is_open() &&
+               bb.is_flagged(i) == tile.is_flagged() &&
+               bb.value(i) == tile.value() &&
+               b_bit(numbers, i) == tile.is_number();
+    if (tile.is_mine()) {
+      b_tiles &= next == i;
+      next = bb.next_mine(i + 1);
+    }
+  }
+  check(b_tiles, "tiles", width, height);
+  check(next == std::numeric_limits<size_type>::max(), "next_mine", width,
+        height);
+  check(bb.mine_count() == mb.mine_count(), "mine_count", width, height);
+  check(bb.open_tiles_count() == mb.open_tiles_count(), "open_tiles_count",
+        width, height);
+  check(bb.flagged_tiles_count() == mb.flagged_tiles_count(),
+        "flagged_tiles_count", width, height);
+
+  // Single tile updates agree with reloading.
+  BitBoard updated(mb);
+  for (size_type i = 1; i < mb.tile_count(); i += 5)
+    mb.flag_tile(i);
+  for (size_type i = 1; i < mb.tile_count(); i += 5)
+    updated.update(mb, i);
+  const BitBoard loaded(mb);
+  BitBoard::plane_type updated_numbers, loaded_numbers;
+  updated.numbers(updated_numbers);
+  loaded.numbers(loaded_numbers);
+  check(updated.open() == loaded.open() &&
+            updated.flagged() == loaded.flagged() &&
+            updated_numbers == loaded_numbers,
+        "update", width, height);
+}
+
+// @brief Checks unknown and adjacent planes against neighbour ranges.
+void test_adjacent(size_type width, size_type height, size_type mines) {
+  MineBoard mb;
+  mb.init(width, height, 11, mines);
+  mb.open_tile(mb.tile_count() / 2);
+  for (size_type i = 0; i < mb.tile_count(); i += 3)
+    if (!mb.m_tiles[i].is_open())
+      mb.flag_tile(i);
+  const BitBoard bb(mb);
+
+  BitBoard::plane_type unknown, adjacent;
+  bb.unknown(unknown);
+  bb.adjacent(unknown, adjacent);
+  bool b_unknown = true, b_adjacent = true;
+  for (size_type i = 0; i < mb.tile_count(); ++i) {
+    const auto& tile = mb.m_tiles[i];
+    b_unknown &= b_bit(unknown, i) == !(tile.is_open() || tile.is_flagged());
+    bool b_next = false;
+    for (auto n : mb.neighbours(i))
+      b_next |= b_bit(unknown, n);
+    b_adjacent &= b_bit(adjacent, i) == b_next;
+  }
+  // Bits past the last tile stay cleared.
+  const auto tail = mb.tile_count() % BitBoard::WORD_BITS;
+  if (tail != 0) {
+    b_unknown &= (unknown.back() >> tail) == 0;
+    b_adjacent &= (adjacent.back() >> tail) == 0;
+  }
+  check(b_unknown, "unknown", width, height);
+  check(b_adjacent, "adjacent", width, height);
+}
+
+int main() {
+  const size_type sizes[][3] = {{1, 1, 0},    {1, 9, 2},    {9, 1, 2},
+                                {8, 8, 10},   {30, 16, 99}, {63, 5, 40},
+                                {64, 5, 40},  {65, 5, 40},  {100, 100, 1200},
+                                {127, 3, 60}, {3, 127, 60}};
+  for (const auto& size : sizes) {
+    test_board(size[0], size[1], size[2]);
+    test_adjacent(size[0], size[1], size[2]);
+  }
+  if (g_failures == 0)
+    std::printf("bitboard: all checks passed\n");
+  return g_failures == 0 ? 0 : 1;
+}
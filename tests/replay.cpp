@@ -0,0 +1,65 @@
+#include <cstdio>
+
+#include "../src/mineboard.hpp"
+#include "../src/mineboardsolver.hpp"
+#include "../src/mineraker.hpp"
+#include "../src/replaylog.hpp"
+#include "../src/replayplayer.hpp"
+
+using namespace rake;
+
+// Amount of failed checks.
+int g_failures = 0;
+
+// @brief Returns the amount of tiles which differ between %a and %b.
+size_type differing_tiles(const MineBoard& a, const MineBoard& b) {
+  if (a.tile_count() != b.tile_count())
+    return a.tile_count() + b.tile_count();
+  size_type differing = 0;
+  for (size_type i = 0; i < a.tile_count(); ++i)
+    differing += a.m_tiles[i].is_mine() != b.m_tiles[i].is_mine() ||
+                 a.m_tiles[i].is_open() != b.m_tiles[i].is_open() ||
+                 a.m_tiles[i].is_flagged() != b.m_tiles[i].is_flagged();
+  return differing;
+}
+
+// @brief Records a game played by the solver after a first move and checks
+// that replaying the log onto a fresh board ends up with the same board.
+void test_game(size_type width, size_type height, size_type mines,
+               MineBoard::seed_type seed) {
+  ReplayLog log;
+  MineBoard recorded;
+  recorded.record(&log);
+  recorded.init(width, height, seed, mines);
+  recorded.open_tile(recorded.tile_count() / 2);
+  {
+    MineBoardSolver solver(recorded);
+    solver.b_solve();
+    // Chords of flagged numbers, as the space key makes them.
+    solver.open_by_flagged();
+  }
+  // Player's own moves after the solver's.
+  for (size_type i = 0; i < recorded.tile_count(); i += 37)
+    recorded.flag_tile(i);
+
+  MineBoard replayed;
+  ReplayPlayer(log.bytes()).play(replayed);
+  const auto differing = differing_tiles(recorded, replayed);
+  if (differing != 0 || replayed.state() != recorded.state()) {
+    ++g_failures;
+    std::printf("FAILED %zux%zu/%zu seed %llu: %zu tiles differ\n", width,
+                height, mines, static_cast<unsigned long long>(seed),
+                differing);
+  }
+}
+
+int main() {
+  for (MineBoard::seed_type seed = 0; seed < 20; ++seed) {
+    test_game(9, 9, 10, seed);
+    test_game(30, 16, 99, seed);
+    test_game(100, 100, 1800, seed);
+  }
+  if (g_failures == 0)
+    std::printf("replay: all checks passed\n");
+  return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+#include <cstdio>
+
+#include "../src/mineboard.hpp"
+#include "../src/mineboardsolver.hpp"
+#include "../src/mineraker.hpp"
+
+using namespace rake;
+
+// Amount of failed checks.
+int g_failures = 0;
+
+// @brief Solves copies of a board once by enumerating every component and
+// once by giving up on them at once, leaving the large ones to the SAT
+// backend. Interior is large enough that the mine count decides nothing, so
+// both must open and flag the same tiles.
+void test_board(size_type width, size_type height, size_type mines,
+                MineBoard::seed_type seed) {
+  MineBoard enumerated;
+  enumerated.init(width, height, seed, mines);
+  enumerated.open_tile(enumerated.tile_count() / 2);
+  MineBoardSolver(enumerated).b_constraint_solve();
+  if (enumerated.state() != MineBoard::NEXT_MOVE)
+    return;
+  MineBoard decided = enumerated;
+
+  MineBoardSolver(enumerated).b_enumerate_solve();
+  MineBoardSolver solver(decided);
+  solver.sat_backend(true);
+  solver.deadline(MineBoardSolver::clock_type::now());
+  solver.b_enumerate_solve();
+
+  size_type differing = 0;
+  for (size_type i = 0; i < decided.tile_count(); ++i)
+    differing +=
+        decided.m_tiles[i].is_open() != enumerated.m_tiles[i].is_open() ||
+        decided.m_tiles[i].is_flagged() != enumerated.m_tiles[i].is_flagged();
+  if (differing != 0) {
+    ++g_failures;
+    std::printf("FAILED %zux%zu/%zu seed %llu: %zu tiles differ\n", width,
+                height, mines, static_cast<unsigned long long>(seed),
+                differing);
+  }
+}
+
+int main() {
+  for (MineBoard::seed_type seed = 0; seed < 40; ++seed) {
+    test_board(100, 100, 1800, seed);
+    test_board(200, 50, 1600, seed);
+  }
+  if (g_failures == 0)
+    std::printf("satbackend: all checks passed\n");
+  return g_failures == 0 ? 0 : 1;
+}
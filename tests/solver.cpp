@@ -6,8 +6,10 @@
 
 #include "../src/gamemanager.hpp"
 #include "../src/mineboard.hpp"
+#include "../src/mineboardformat.hpp"
 #include "../src/mineboardsolver.hpp"
 #include "../src/mineraker.hpp"
+#include "../src/solverexecutor.hpp"
 #include "../src/texture.hpp"
 #include "../src/vectorspace.hpp"
 #include "../src/windowmanager.hpp"
@@ -27,35 +29,25 @@ int main() {
 
   using namespace rake;
   MineBoard mb;
-  MineBoardSolver mbs(mb);
 
-  std::string set_mine = {"---1*23*2-2***334*4*3*2**323**"
-                          "11-12*4*3-3*64****4*42334**5**"
-                          "*2-1223*312*3*35*6422*11*33***"
-                          "*2-1*113*4433113***2111112235*"
-                          "22-23324****2124***3112323*22*"
-                          "*1-1**3**5432*4***5*11***5*422"
-                          "12246*5323*223**6*522124*5*6*2"
-                          "-1*****435*31*434*6*311124***3"
-                          "23335******213*44***3*211*345*"
-                          "**1-3*75432224***66433*21111**"
-                          "221-2***3333**46****35*412246*"
-                          "11--25*5****54*5*643***3*4****"
-                          "*2-12**4234*4*5***113*444***6*"
-                          "*433*4*2-1224**33221334**4424*"
-                          "4***222322*12*31--1*2**44*2-2*"
-                          "***31-1**211111---1123*22*2-11"};
-  mb.init(30, 16, 0, 170);
-  mb.m_state = MineBoard::State::NEXT_MOVE;
-  for (size_type i = 0; i < mb.m_tiles.size(); ++i) {
-    if (set_mine[i] == '*')
-      mb.m_tiles[i].set_mine();
-    else
-      mb.m_tiles[i].set_empty();
-  }
-  mb.m_set_numbered_tiles();
+  mb = MineBoardFormat::parse("30 16\n"
+                              "....*..*...***...*.*.*.**...**\n"
+                              ".....*.*...*..****.*.....**.**\n"
+                              "*......*...*.*..*....*..*..***\n"
+                              "*...*...*.......***..........*\n"
+                              "........****....***.......*..*\n"
+                              "*...**.**....*.***.*..***.*...\n"
+                              ".....*....*...**.*......*.*.*.\n"
+                              "..*****...*..*...*.*......***.\n"
+                              ".....******...*..***.*...*...*\n"
+                              "**...*........***.....*.....**\n"
+                              ".....***....**..****..*......*\n"
+                              "......*.****..*.*...***.*.****\n"
+                              "*....**....*.*.***...*...***.*\n"
+                              "*...*.*......**........**....*\n"
+                              ".***......*..*.....*.**..*...*\n"
+                              "***....**.............*..*....\n");
   mb.open_tile(0);
-  // mbs.b_solve();
 
   rake::WindowManager wm{rake::SCREEN_WIDTH, rake::SCREEN_HEIGHT,
                          "Mineraker alpha",
@@ -63,6 +55,15 @@ int main() {
   rake::Texture tx(wm, "img/medium.png");
   rake::GameManager gm{&wm, &mb, &tx};
 
+  // Solving passes run off the frame loop.
+  SolverExecutor executor;
+  // Changes of the board seen, which tell results of passes started from an
+  // older board apart.
+  size_type board_version = 0;
+  mb.subscribe([&board_version](const MineBoard::Changes&) {
+    ++board_version;
+  });
+
   SDL_Event event;
   SDL_DisplayMode display_mode;
   bool quit = false;
@@ -88,12 +89,24 @@ int main() {
     std::this_thread::sleep_for(sleep_time);
     frame_time = steady_clock::now().time_since_epoch();
 
+    // Results of the previous pass are shown once it has finished, and the
+    // next pass starts from them.
+    executor.complete();
+    if (executor.pending() == 0)
+      executor.submit(
+          mb,
+          [](MineBoard&, MineBoardSolver& solver) {
+            if (solver.b_constraint_solve())
+              solver.open_by_flagged();
+            solver.b_enumerate_solve();
+          },
+          [&mb, &board_version, version = board_version](MineBoard& result) {
+            if (version == board_version)
+              mb = std::move(result);
+          });
+
     SDL_RenderClear(wm);
     gm.render();
     SDL_RenderPresent(wm);
-
-    if (mbs.b_overlap_solve() || mbs.b_common_solve() || mbs.b_pattern_solve())
-      mbs.open_by_flagged();
-    mbs.b_suffle_solve();
   }
 }
\ No newline at end of file